@@ -0,0 +1,168 @@
+/*
+ * Application-level packet counters.
+ *
+ * Hooks the Tx/Rx trace sources of UdpEchoClient/UdpEchoServer and
+ * OnOffApplication/PacketSink through direct object pointers (no
+ * Config::Connect string paths) and counts packets and bytes per node in
+ * flat arrays indexed by node ID, so a packet costs one array update no
+ * matter how many hosts the scenario has.
+ */
+
+#ifndef APP_COUNTERS_H
+#define APP_COUNTERS_H
+
+#include <ns3/applications-module.h>
+#include <ns3/core-module.h>
+#include <ns3/network-module.h>
+
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Per-node Tx/Rx packet and byte counters for one group of applications.
+ */
+class AppCounters : public SimpleRefCount<AppCounters>
+{
+  public:
+    /**
+     * Size the arrays for all nodes created so far.
+     */
+    AppCounters()
+        : m_txPackets(NodeList::GetNNodes(), 0),
+          m_rxPackets(NodeList::GetNNodes(), 0),
+          m_txBytes(NodeList::GetNNodes(), 0),
+          m_rxBytes(NodeList::GetNNodes(), 0)
+    {
+    }
+
+    /**
+     * Count the traffic of every supported application in the container.
+     * \param apps The applications.
+     */
+    void Attach(ApplicationContainer apps)
+    {
+        for (uint32_t i = 0; i < apps.GetN(); i++)
+        {
+            Attach(apps.Get(i));
+        }
+    }
+
+    /**
+     * Count the traffic of one application.
+     * \param app An UdpEchoClient, UdpEchoServer, OnOffApplication or
+     *            PacketSink.
+     */
+    void Attach(Ptr<Application> app)
+    {
+        uint32_t id = app->GetNode()->GetId();
+        NS_ABORT_MSG_IF(id >= m_txPackets.size(), "Node " << id << " created after the counters");
+        if (DynamicCast<UdpEchoClient>(app))
+        {
+            app->TraceConnectWithoutContext("Tx", MakeBoundCallback(&AppCounters::Tx, this, id));
+            app->TraceConnectWithoutContext("Rx", MakeBoundCallback(&AppCounters::Rx, this, id));
+        }
+        else if (DynamicCast<UdpEchoServer>(app))
+        {
+            // The server has no Tx trace; it echoes every packet it receives.
+            app->TraceConnectWithoutContext("Rx",
+                                            MakeBoundCallback(&AppCounters::Echo, this, id));
+        }
+        else if (DynamicCast<OnOffApplication>(app))
+        {
+            app->TraceConnectWithoutContext("Tx", MakeBoundCallback(&AppCounters::Tx, this, id));
+        }
+        else if (DynamicCast<PacketSink>(app))
+        {
+            app->TraceConnectWithoutContext("Rx",
+                                            MakeBoundCallback(&AppCounters::SinkRx, this, id));
+        }
+        else
+        {
+            NS_ABORT_MSG("Unsupported application " << app->GetInstanceTypeId().GetName());
+        }
+    }
+
+    /** \return the packets sent by all nodes. */
+    uint64_t GetTxPackets() const
+    {
+        return Sum(m_txPackets);
+    }
+
+    /** \return the packets received by all nodes. */
+    uint64_t GetRxPackets() const
+    {
+        return Sum(m_rxPackets);
+    }
+
+    /** \return the bytes sent by all nodes. */
+    uint64_t GetTxBytes() const
+    {
+        return Sum(m_txBytes);
+    }
+
+    /** \return the bytes received by all nodes. */
+    uint64_t GetRxBytes() const
+    {
+        return Sum(m_rxBytes);
+    }
+
+    /** \return the packets sent by one node. */
+    uint64_t GetTxPackets(uint32_t nodeId) const
+    {
+        return m_txPackets[nodeId];
+    }
+
+    /** \return the packets received by one node. */
+    uint64_t GetRxPackets(uint32_t nodeId) const
+    {
+        return m_rxPackets[nodeId];
+    }
+
+  private:
+    static void Tx(AppCounters* counters, uint32_t id, Ptr<const Packet> packet)
+    {
+        counters->m_txPackets[id]++;
+        counters->m_txBytes[id] += packet->GetSize();
+    }
+
+    static void Rx(AppCounters* counters, uint32_t id, Ptr<const Packet> packet)
+    {
+        counters->m_rxPackets[id]++;
+        counters->m_rxBytes[id] += packet->GetSize();
+    }
+
+    static void Echo(AppCounters* counters, uint32_t id, Ptr<const Packet> packet)
+    {
+        Rx(counters, id, packet);
+        Tx(counters, id, packet);
+    }
+
+    static void SinkRx(AppCounters* counters,
+                       uint32_t id,
+                       Ptr<const Packet> packet,
+                       const Address& from)
+    {
+        Rx(counters, id, packet);
+    }
+
+    static uint64_t Sum(const std::vector<uint64_t>& v)
+    {
+        uint64_t sum = 0;
+        for (uint64_t x : v)
+        {
+            sum += x;
+        }
+        return sum;
+    }
+
+    std::vector<uint64_t> m_txPackets;
+    std::vector<uint64_t> m_rxPackets;
+    std::vector<uint64_t> m_txBytes;
+    std::vector<uint64_t> m_rxBytes;
+};
+
+} // namespace ns3
+
+#endif /* APP_COUNTERS_H */
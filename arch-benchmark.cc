@@ -0,0 +1,315 @@
+/*
+ * Architecture comparison benchmark.
+ *
+ * Runs the four control architectures of this repository one after the
+ * other on the same hosts, links, traffic-matrix workload and random seeds,
+ * and prints one comparison table:
+ *
+ *  - centralized: one controller managing both switches (single-domain.cc)
+ *  - per-switch:  a line of switches, each with its own controller
+ *                 (controller_per_switch.cc)
+ *  - distributed: two domains of one switch and one controller each
+ *                 (distributed-sdn.cc)
+ *  - legacy:      two IPv4 routers with global routing (distributed-network.cc)
+ *
+ * Hosts are split in contiguous blocks over the switches (or routers), every
+ * link is 100 Mbps / 2 ms, and all OpenFlow architectures use the same
+ * DomainController learning logic. Flow setup time is the time from a flow's
+ * start to the first byte at its sink; it includes ARP, the controller round
+ * trips and the TCP handshake.
+ */
+
+#include <ns3/applications-module.h>
+#include <ns3/core-module.h>
+#include <ns3/csma-module.h>
+#include <ns3/flow-monitor-module.h>
+#include <ns3/internet-module.h>
+#include <ns3/network-module.h>
+#include <ns3/ofswitch13-module.h>
+
+#include "domain-controller.h"
+#include "traffic-matrix.h"
+
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <vector>
+
+using namespace ns3;
+
+/** Results of one architecture run. */
+struct BenchResult
+{
+    std::string name;
+    uint32_t flows;
+    double throughputKbps;
+    double pdr;
+    double p99DelayMs;
+    double setupMs;
+    int64_t wallMs;
+};
+
+/** Record the first byte received by each workload flow. */
+static void
+FirstByte(std::vector<Time>* firstRx, uint32_t idx, Ptr<const Packet> packet, const Address& from)
+{
+    if ((*firstRx)[idx].IsZero())
+    {
+        (*firstRx)[idx] = Simulator::Now();
+    }
+}
+
+/**
+ * Attach the hosts in contiguous blocks to the switches (or routers) and
+ * chain these in a line.
+ * \return the ports of each switch, host ports first.
+ */
+static std::vector<NetDeviceContainer>
+BuildLine(NodeContainer hosts,
+          NodeContainer switches,
+          CsmaHelper& csmaHelper,
+          NetDeviceContainer& hostDevices)
+{
+    uint32_t nHosts = hosts.GetN();
+    uint32_t nSwitches = switches.GetN();
+    std::vector<NetDeviceContainer> switchPorts(nSwitches);
+    for (uint32_t i = 0; i < nHosts; i++)
+    {
+        uint32_t s = i * nSwitches / nHosts;
+        NetDeviceContainer pairDevs = csmaHelper.Install(NodeContainer(hosts.Get(i), switches.Get(s)));
+        hostDevices.Add(pairDevs.Get(0));
+        switchPorts[s].Add(pairDevs.Get(1));
+    }
+    for (uint32_t s = 0; s + 1 < nSwitches; s++)
+    {
+        NetDeviceContainer pairDevs =
+            csmaHelper.Install(NodeContainer(switches.Get(s), switches.Get(s + 1)));
+        switchPorts[s].Add(pairDevs.Get(0));
+        switchPorts[s + 1].Add(pairDevs.Get(1));
+    }
+    return switchPorts;
+}
+
+/**
+ * Build, run and measure one architecture.
+ */
+static BenchResult
+RunArchitecture(std::string arch,
+                uint32_t nHosts,
+                uint32_t perSwitch,
+                std::string workload,
+                double flowRate,
+                uint32_t flowSize,
+                double duration)
+{
+    NodeContainer hosts;
+    hosts.Create(nHosts);
+    InternetStackHelper internet;
+    internet.Install(hosts);
+
+    CsmaHelper csmaHelper;
+    csmaHelper.SetChannelAttribute("DataRate", DataRateValue(DataRate("100Mbps")));
+    csmaHelper.SetChannelAttribute("Delay", TimeValue(MilliSeconds(2)));
+
+    NetDeviceContainer hostDevices;
+    Ipv4InterfaceContainer hostIpIfaces;
+    if (arch == "legacy")
+    {
+        // Every link is its own /30; the routers learn them all
+        NodeContainer routers;
+        routers.Create(2);
+        internet.Install(routers);
+        std::vector<NetDeviceContainer> routerPorts =
+            BuildLine(hosts, routers, csmaHelper, hostDevices);
+
+        Ipv4AddressHelper ipv4;
+        ipv4.SetBase("10.2.0.0", "255.255.255.252");
+        uint32_t hostPort[2] = {0, 0};
+        for (uint32_t i = 0; i < nHosts; i++)
+        {
+            uint32_t r = i * 2 / nHosts;
+            NetDeviceContainer link(hostDevices.Get(i), routerPorts[r].Get(hostPort[r]++));
+            hostIpIfaces.Add(ipv4.Assign(link).Get(0));
+            ipv4.NewNetwork();
+        }
+        NetDeviceContainer core(routerPorts[0].Get(routerPorts[0].GetN() - 1),
+                                routerPorts[1].Get(routerPorts[1].GetN() - 1));
+        ipv4.Assign(core);
+        Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+    }
+    else
+    {
+        uint32_t nSwitches = (arch == "per-switch") ? perSwitch : 2;
+        NodeContainer switches;
+        switches.Create(nSwitches);
+        std::vector<NetDeviceContainer> switchPorts =
+            BuildLine(hosts, switches, csmaHelper, hostDevices);
+
+        if (arch == "centralized")
+        {
+            Ptr<Node> controllerNode = CreateObject<Node>();
+            Ptr<OFSwitch13InternalHelper> of13Helper = CreateObject<OFSwitch13InternalHelper>();
+            of13Helper->InstallController(controllerNode, CreateObject<DomainController>());
+            for (uint32_t s = 0; s < nSwitches; s++)
+            {
+                of13Helper->InstallSwitch(switches.Get(s), switchPorts[s]);
+            }
+            of13Helper->CreateOpenFlowChannels();
+        }
+        else
+        {
+            // One controller per switch: per-switch and distributed only
+            // differ in the number of switches
+            NodeContainer controllers;
+            controllers.Create(nSwitches);
+            for (uint32_t s = 0; s < nSwitches; s++)
+            {
+                Ptr<OFSwitch13InternalHelper> of13Helper =
+                    CreateObject<OFSwitch13InternalHelper>();
+                of13Helper->InstallController(controllers.Get(s), CreateObject<DomainController>());
+                of13Helper->InstallSwitch(switches.Get(s), switchPorts[s]);
+                of13Helper->CreateOpenFlowChannels();
+            }
+        }
+
+        Ipv4AddressHelper ipv4;
+        ipv4.SetBase("10.1.0.0", "255.255.0.0");
+        hostIpIfaces = ipv4.Assign(hostDevices);
+    }
+
+    // Same flows in every run: the workload streams are fixed
+    Ptr<TrafficMatrixWorkload> flows = Create<TrafficMatrixWorkload>();
+    flows->SetPattern(workload);
+    flows->SetArrivalRate(flowRate);
+    flows->SetFlowSize(flowSize, 1.2, 100 * flowSize);
+    flows->AssignStreams(1000);
+    flows->Install(hosts, hostIpIfaces, Seconds(1.0), Seconds(1.0 + duration));
+    std::vector<Time> firstRx(flows->GetFlows().size());
+    for (const auto& flow : flows->GetFlows())
+    {
+        flow.sink->TraceConnectWithoutContext("Rx", MakeBoundCallback(&FirstByte, &firstRx, flow.id));
+    }
+
+    // Monitor the hosts only, leaving out the OpenFlow channels
+    FlowMonitorHelper flowmon;
+    Ptr<FlowMonitor> monitor = flowmon.Install(hosts);
+    Simulator::Stop(Seconds(1.0 + duration + 5.0));
+    SystemWallClockMs wallClock;
+    wallClock.Start();
+    Simulator::Run();
+
+    BenchResult result;
+    result.name = arch;
+    result.wallMs = wallClock.End();
+    result.flows = flows->GetFlows().size();
+
+    uint64_t txPackets = 0;
+    uint64_t rxPackets = 0;
+    uint64_t rxBytes = 0;
+    std::map<uint32_t, uint64_t> delayBins;
+    double binWidth = 0;
+    for (const auto& entry : monitor->GetFlowStats())
+    {
+        const FlowMonitor::FlowStats& st = entry.second;
+        txPackets += st.txPackets;
+        rxPackets += st.rxPackets;
+        rxBytes += st.rxBytes;
+        for (uint32_t b = 0; b < st.delayHistogram.GetNBins(); b++)
+        {
+            delayBins[b] += st.delayHistogram.GetBinCount(b);
+            binWidth = st.delayHistogram.GetBinWidth(b);
+        }
+    }
+    result.throughputKbps = rxBytes * 8.0 / duration / 1024;
+    result.pdr = txPackets ? rxPackets * 100.0 / txPackets : 0;
+
+    uint64_t seen = 0;
+    result.p99DelayMs = 0;
+    for (const auto& bin : delayBins)
+    {
+        seen += bin.second;
+        if (seen >= 0.99 * rxPackets)
+        {
+            result.p99DelayMs = (bin.first + 1) * binWidth * 1000;
+            break;
+        }
+    }
+
+    double setupSum = 0;
+    uint32_t setupFlows = 0;
+    for (const auto& flow : flows->GetFlows())
+    {
+        if (!firstRx[flow.id].IsZero())
+        {
+            setupSum += (firstRx[flow.id] - flow.start).GetSeconds();
+            setupFlows++;
+        }
+    }
+    result.setupMs = setupFlows ? setupSum / setupFlows * 1000 : 0;
+
+    Simulator::Destroy();
+    Ipv4AddressGenerator::Reset();
+    return result;
+}
+
+int
+main(int argc, char* argv[])
+{
+    uint32_t nHosts = 20;
+    uint32_t perSwitch = 4;
+    std::string archs = "centralized,per-switch,distributed,legacy";
+    std::string workload = "uniform";
+    double flowRate = 20;
+    uint32_t flowSize = 100000;
+    double duration = 10;
+    uint32_t seed = 1;
+    uint32_t run = 1;
+
+    // Configure command line parameters
+    CommandLine cmd;
+    cmd.AddValue("hosts", "Number of hosts", nHosts);
+    cmd.AddValue("switches", "Number of switches of the per-switch architecture", perSwitch);
+    cmd.AddValue("archs", "Comma-separated architectures to run", archs);
+    cmd.AddValue("workload", "Traffic matrix: uniform, permutation, hotspot, incast or a file", workload);
+    cmd.AddValue("flowRate", "Workload flow arrival rate (flows/s)", flowRate);
+    cmd.AddValue("flowSize", "Mean workload flow size (bytes)", flowSize);
+    cmd.AddValue("duration", "Workload duration (seconds)", duration);
+    cmd.AddValue("seed", "Random seed", seed);
+    cmd.AddValue("run", "Random run number", run);
+    cmd.Parse(argc, argv);
+
+    NS_ABORT_MSG_IF(nHosts < perSwitch || nHosts < 2, "Need at least one host per switch");
+
+    // Enable checksum computations (required by OFSwitch13 module)
+    GlobalValue::Bind("ChecksumEnabled", BooleanValue(true));
+
+    std::vector<BenchResult> results;
+    std::istringstream names(archs);
+    std::string arch;
+    while (std::getline(names, arch, ','))
+    {
+        NS_ABORT_MSG_IF(arch != "centralized" && arch != "per-switch" && arch != "distributed" &&
+                            arch != "legacy",
+                        "Unknown architecture " << arch);
+        RngSeedManager::SetSeed(seed);
+        RngSeedManager::SetRun(run);
+        results.push_back(
+            RunArchitecture(arch, nHosts, perSwitch, workload, flowRate, flowSize, duration));
+    }
+
+    std::ostringstream table;
+    table << std::left << std::setw(13) << "architecture" << std::right << std::setw(7) << "flows"
+          << std::setw(16) << "thpt(Kbps)" << std::setw(9) << "PDR(%)" << std::setw(15)
+          << "p99 delay(ms)" << std::setw(11) << "setup(ms)" << std::setw(11) << "wall(ms)";
+    NS_LOG_UNCOND("--------Architecture comparison----------" << std::endl);
+    NS_LOG_UNCOND(table.str());
+    for (const auto& r : results)
+    {
+        std::ostringstream row;
+        row << std::fixed << std::setprecision(2) << std::left << std::setw(13) << r.name
+            << std::right << std::setw(7) << r.flows << std::setw(16) << r.throughputKbps
+            << std::setw(9) << r.pdr << std::setw(15) << r.p99DelayMs << std::setw(11)
+            << r.setupMs << std::setw(11) << r.wallMs;
+        NS_LOG_UNCOND(row.str());
+    }
+}
@@ -0,0 +1,206 @@
+/*
+ * Out-of-band OpenFlow control network.
+ *
+ * OFSwitch13InternalHelper::CreateOpenFlowChannels () connects switches and
+ * controllers over a fast channel with no propagation delay. This helper
+ * builds the control plane as a management LAN instead: every controller
+ * and switch node gets a CSMA link of configurable rate and delay to one
+ * shared management switch (a learning bridge), so control messages of all
+ * switches compete for the controller links and a distant controller adds
+ * its round trip to every flow setup. Switches are then connected to their
+ * controllers over it with StartControllerConnection (), in place of
+ * CreateOpenFlowChannels () on the OFSwitch13 helpers.
+ */
+
+#ifndef CONTROL_NETWORK_H
+#define CONTROL_NETWORK_H
+
+#include <ns3/bridge-module.h>
+#include <ns3/core-module.h>
+#include <ns3/csma-module.h>
+#include <ns3/internet-module.h>
+#include <ns3/network-module.h>
+#include <ns3/ofswitch13-module.h>
+
+#include <map>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Management LAN carrying the OpenFlow channels.
+ */
+class ControlNetwork : public SimpleRefCount<ControlNetwork>
+{
+  public:
+    ControlNetwork()
+        : m_rate("1Gbps"),
+          m_delay(MicroSeconds(100))
+    {
+    }
+
+    /**
+     * \param rate The data rate of every management link.
+     */
+    void SetLinkRate(DataRate rate)
+    {
+        m_rate = rate;
+    }
+
+    /**
+     * \param delay The one-way delay of every management link not given
+     *              its own with SetNodeDelay ().
+     */
+    void SetLinkDelay(Time delay)
+    {
+        m_delay = delay;
+    }
+
+    /**
+     * Place a node further away from the management switch, e.g. a
+     * controller in another site.
+     * \param node The controller or switch node.
+     * \param delay The one-way delay of its management link.
+     */
+    void SetNodeDelay(Ptr<Node> node, Time delay)
+    {
+        m_nodeDelay[node] = delay;
+    }
+
+    /**
+     * Connect a switch to a controller once the network is installed.
+     * Call once per controller of the switch.
+     * \param device The OpenFlow switch device.
+     * \param controller The controller application, already installed.
+     */
+    void Connect(Ptr<OFSwitch13Device> device, Ptr<OFSwitch13Controller> controller)
+    {
+        m_channels.push_back({device, controller});
+    }
+
+    /**
+     * Build the management LAN for the nodes of all connections, address
+     * it from 10.100.0.0/24 and open the OpenFlow connections.
+     */
+    void Install()
+    {
+        NS_ABORT_MSG_IF(m_channels.empty(), "No OpenFlow connection to install");
+        m_switch = CreateObject<Node>();
+
+        NodeContainer members;
+        for (const auto& channel : m_channels)
+        {
+            for (Ptr<Node> node : {channel.device->GetNode(), channel.controller->GetNode()})
+            {
+                if (m_addresses.find(node) == m_addresses.end())
+                {
+                    m_addresses[node] = Ipv4Address();
+                    members.Add(node);
+                }
+            }
+        }
+
+        InternetStackHelper internet;
+        NetDeviceContainer memberDevices;
+        NetDeviceContainer switchPorts;
+        for (uint32_t i = 0; i < members.GetN(); i++)
+        {
+            Ptr<Node> node = members.Get(i);
+            if (!node->GetObject<Ipv4>())
+            {
+                internet.Install(node);
+            }
+            auto it = m_nodeDelay.find(node);
+            CsmaHelper csmaHelper;
+            csmaHelper.SetChannelAttribute("DataRate", DataRateValue(m_rate));
+            csmaHelper.SetChannelAttribute(
+                "Delay",
+                TimeValue(it == m_nodeDelay.end() ? m_delay : it->second));
+            NetDeviceContainer link = csmaHelper.Install(NodeContainer(node, m_switch));
+            memberDevices.Add(link.Get(0));
+            switchPorts.Add(link.Get(1));
+            link.Get(1)->TraceConnectWithoutContext(
+                "MacTx",
+                MakeBoundCallback(&ControlNetwork::Forwarded, this));
+            link.Get(1)->TraceConnectWithoutContext(
+                "MacTxDrop",
+                MakeBoundCallback(&ControlNetwork::Dropped, this));
+        }
+        BridgeHelper bridge;
+        bridge.Install(m_switch, switchPorts);
+
+        Ipv4AddressHelper ipv4;
+        ipv4.SetBase("10.100.0.0", "255.255.255.0");
+        Ipv4InterfaceContainer ifaces = ipv4.Assign(memberDevices);
+        for (uint32_t i = 0; i < members.GetN(); i++)
+        {
+            m_addresses[members.Get(i)] = ifaces.GetAddress(i);
+        }
+
+        for (const auto& channel : m_channels)
+        {
+            UintegerValue port;
+            channel.controller->GetAttribute("Port", port);
+            channel.device->StartControllerConnection(
+                InetSocketAddress(m_addresses[channel.controller->GetNode()], port.Get()));
+        }
+    }
+
+    /** \return the management switch node. */
+    Ptr<Node> GetManagementSwitch() const
+    {
+        return m_switch;
+    }
+
+    /**
+     * Print the link parameters and the frames the management switch
+     * forwarded and dropped on full output queues.
+     */
+    void Report() const
+    {
+        NS_LOG_UNCOND("Management links =" << m_addresses.size() << " rate =" << m_rate
+                                           << " delay =" << m_delay.GetSeconds() * 1000 << "ms");
+        for (const auto& entry : m_nodeDelay)
+        {
+            NS_LOG_UNCOND("Node " << entry.first->GetId() << " (" << m_addresses.at(entry.first)
+                                  << ") delay =" << entry.second.GetSeconds() * 1000 << "ms");
+        }
+        NS_LOG_UNCOND("Management switch frames forwarded =" << m_forwarded << " bytes ="
+                                                             << m_forwardedBytes
+                                                             << " dropped =" << m_dropped);
+    }
+
+  private:
+    /** One switch to controller connection. */
+    struct Channel
+    {
+        Ptr<OFSwitch13Device> device;
+        Ptr<OFSwitch13Controller> controller;
+    };
+
+    static void Forwarded(ControlNetwork* net, Ptr<const Packet> packet)
+    {
+        net->m_forwarded++;
+        net->m_forwardedBytes += packet->GetSize();
+    }
+
+    static void Dropped(ControlNetwork* net, Ptr<const Packet> packet)
+    {
+        net->m_dropped++;
+    }
+
+    DataRate m_rate;
+    Time m_delay;
+    std::map<Ptr<Node>, Time> m_nodeDelay;
+    std::vector<Channel> m_channels;
+    std::map<Ptr<Node>, Ipv4Address> m_addresses;
+    Ptr<Node> m_switch;
+    uint64_t m_forwarded{0};
+    uint64_t m_forwardedBytes{0};
+    uint64_t m_dropped{0};
+};
+
+} // namespace ns3
+
+#endif /* CONTROL_NETWORK_H */
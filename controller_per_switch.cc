@@ -18,14 +18,19 @@
  * Author: Luciano Chaves <luciano@lrc.ic.unicamp.br>
  *         Vitor M. Eichemberger <vitor.marge@gmail.com>
  *
- * Two hosts connected to different OpenFlow switches.
- * Each switch is managed by an independent default learning controller application.
+ * N OpenFlow switches in a line, ring or full mesh, each managed by its own
+ * learning controller through its own OFSwitch13InternalHelper.
  *
- *            Learning Controller   Learning Controller
- *                    |                     |
- *               +----------+          +----------+
- *    Host 0 === | Switch 0 | ======== | Switch 1 | === Host 1
- *               +----------+          +----------+
+ *         Controller 0    Controller 1          Controller N-1
+ *              |               |                      |
+ *         +----------+    +----------+          +------------+
+ *         | Switch 0 | == | Switch 1 | == ... == | Switch N-1 |
+ *         +----------+    +----------+          +------------+
+ *           |  ...  |       |  ...  |             |  ...  |
+ *             hosts           hosts                 hosts
+ *
+ * Ring and mesh links that are not on a spanning tree (BFS from switch 0)
+ * are blocked by the controllers, so floods do not loop.
  */
 
 #include <ns3/core-module.h>
@@ -36,6 +41,13 @@
 #include <ns3/internet-apps-module.h>
 #include <ns3/flow-monitor-module.h>
 
+#include "domain-controller.h"
+#include "pcapng-capture.h"
+#include "traffic-matrix.h"
+
+#include <queue>
+#include <vector>
+
 using namespace ns3;
 
 int
@@ -44,6 +56,15 @@ main (int argc, char *argv[])
     uint16_t simTime = 10;
     bool verbose = false;
     bool trace = false;
+    uint32_t snapLen = 0;
+    uint32_t sampleRate = 1;
+    bool sampleFlows = false;
+    uint32_t nSwitches = 2;
+    uint32_t hostsPerSwitch = 10;
+    std::string topology = "line";
+    std::string workload;
+    double flowRate = 20;
+    uint32_t flowSize = 100000;
     uint32_t SentPackets = 0;
     uint32_t ReceivedPackets = 0;
     uint32_t LostPackets = 0;
@@ -53,6 +74,18 @@ main (int argc, char *argv[])
     cmd.AddValue ("simTime", "Simulation time (seconds)", simTime);
     cmd.AddValue ("verbose", "Enable verbose output", verbose);
     cmd.AddValue ("trace", "Enable datapath stats and pcap traces", trace);
+    cmd.AddValue ("snapLen", "Captured bytes per frame (0 for full frames)", snapLen);
+    cmd.AddValue ("sampleRate", "Capture one in N packets (or flows)", sampleRate);
+    cmd.AddValue ("sampleFlows", "Sample whole flows instead of packets", sampleFlows);
+    cmd.AddValue ("switches", "Number of switches, each with its own controller", nSwitches);
+    cmd.AddValue ("hostsPerSwitch", "Number of hosts on each switch", hostsPerSwitch);
+    cmd.AddValue ("topology", "Switch topology: line, ring or mesh", topology);
+    cmd.AddValue ("workload",
+                  "Traffic matrix: uniform, permutation, hotspot, incast or a matrix file "
+                  "(empty for the ping only)",
+                  workload);
+    cmd.AddValue ("flowRate", "Workload flow arrival rate (flows/s)", flowRate);
+    cmd.AddValue ("flowSize", "Mean workload flow size (bytes)", flowSize);
     cmd.Parse (argc, argv);
 
     if (verbose)
@@ -72,13 +105,18 @@ main (int argc, char *argv[])
     // Enable checksum computations (required by OFSwitch13 module)
     GlobalValue::Bind ("ChecksumEnabled", BooleanValue (true));
 
-    // Create two host nodes
+    NS_ABORT_MSG_IF (nSwitches < 2, "Need at least two switches");
+    NS_ABORT_MSG_IF (topology != "line" && topology != "ring" && topology != "mesh",
+                     "Unknown topology " << topology);
+
+    // Create the host nodes
+    uint32_t nHosts = nSwitches * hostsPerSwitch;
     NodeContainer hosts;
-    hosts.Create (20);
+    hosts.Create (nHosts);
 
-    // Create two switch nodes
+    // Create the switch nodes
     NodeContainer switches;
-    switches.Create (2);
+    switches.Create (nSwitches);
 
     // Use the CsmaHelper to connect hosts and switches
     CsmaHelper csmaHelper;
@@ -88,46 +126,98 @@ main (int argc, char *argv[])
     NodeContainer pair;
     NetDeviceContainer pairDevs;
     NetDeviceContainer hostDevices;
-    NetDeviceContainer switchPorts [2];
-    switchPorts [0] = NetDeviceContainer ();
-    switchPorts [1] = NetDeviceContainer ();
+    std::vector<NetDeviceContainer> switchPorts (nSwitches);
 
-    // Connect host 0 to first switch
-    for (int i = 0; i < 10; i++)
+    // Connect each block of hosts to its switch
+    for (uint32_t i = 0; i < nHosts; i++)
     {
-        pair = NodeContainer (hosts.Get (i), switches.Get (0));
+        pair = NodeContainer (hosts.Get (i), switches.Get (i / hostsPerSwitch));
         pairDevs = csmaHelper.Install (pair);
         hostDevices.Add (pairDevs.Get (0));
-        switchPorts [i].Add (pairDevs.Get (1));
+        switchPorts [i / hostsPerSwitch].Add (pairDevs.Get (1));
     }
-    for (int i = 10; i < 20; i++)
+
+    // Connect the switches
+    struct Link
     {
-        pair = NodeContainer (hosts.Get (i), switches.Get (1));
-        pairDevs = csmaHelper.Install (pair);
-        hostDevices.Add (pairDevs.Get (0));
-        switchPorts [i].Add (pairDevs.Get (1));
+        uint32_t a, b;         // switch indexes
+        uint32_t portA, portB; // OpenFlow port numbers
+    };
+    std::vector<Link> links;
+    for (uint32_t a = 0; a < nSwitches; a++)
+    {
+        for (uint32_t b = a + 1; b < nSwitches; b++)
+        {
+            bool connected = (b == a + 1) ||
+                             (topology == "ring" && a == 0 && b == nSwitches - 1 && nSwitches > 2) ||
+                             topology == "mesh";
+            if (!connected)
+            {
+                continue;
+            }
+            pair = NodeContainer (switches.Get (a), switches.Get (b));
+            pairDevs = csmaHelper.Install (pair);
+            switchPorts [a].Add (pairDevs.Get (0));
+            switchPorts [b].Add (pairDevs.Get (1));
+            links.push_back ({a, b, switchPorts [a].GetN (), switchPorts [b].GetN ()});
+        }
     }
 
-    // Connect the switches
-    pair = NodeContainer (switches.Get (0), switches.Get (1));
-    pairDevs = csmaHelper.Install (pair);
-    switchPorts [0].Add (pairDevs.Get (0));
-    switchPorts [1].Add (pairDevs.Get (1));
+    // Spanning tree: breadth-first from switch 0
+    std::vector<std::vector<uint32_t>> adjacent (nSwitches);
+    for (uint32_t l = 0; l < links.size (); l++)
+    {
+        adjacent [links [l].a].push_back (l);
+        adjacent [links [l].b].push_back (l);
+    }
+    std::vector<bool> reached (nSwitches, false);
+    std::vector<bool> treeLink (links.size (), false);
+    std::queue<uint32_t> frontier;
+    frontier.push (0);
+    reached [0] = true;
+    while (!frontier.empty ())
+    {
+        uint32_t s = frontier.front ();
+        frontier.pop ();
+        for (uint32_t l : adjacent [s])
+        {
+            uint32_t other = (links [l].a == s) ? links [l].b : links [l].a;
+            if (!reached [other])
+            {
+                reached [other] = true;
+                treeLink [l] = true;
+                frontier.push (other);
+            }
+        }
+    }
 
-    // Create two controller nodes
+    // Create one controller node per switch
     NodeContainer controllers;
-    controllers.Create (2);
-
-    // Configure both OpenFlow network domains
-    Ptr<OFSwitch13InternalHelper> of13Helper0 = CreateObject<OFSwitch13InternalHelper> ();
-    of13Helper0->InstallController (controllers.Get (0));
-    of13Helper0->InstallSwitch (switches.Get (0), switchPorts [0]);
-    of13Helper0->CreateOpenFlowChannels ();
+    controllers.Create (nSwitches);
 
-    Ptr<OFSwitch13InternalHelper> of13Helper1 = CreateObject<OFSwitch13InternalHelper> ();
-    of13Helper1->InstallController (controllers.Get (1));
-    of13Helper1->InstallSwitch (switches.Get (1), switchPorts [1]);
-    of13Helper1->CreateOpenFlowChannels ();
+    // Configure one OpenFlow network domain per switch
+    std::vector<Ptr<DomainController>> ctrls (nSwitches);
+    std::vector<Ptr<OFSwitch13InternalHelper>> of13Helpers (nSwitches);
+    std::vector<uint64_t> dpIds (nSwitches);
+    for (uint32_t s = 0; s < nSwitches; s++)
+    {
+        ctrls [s] = CreateObject<DomainController> ();
+        of13Helpers [s] = CreateObject<OFSwitch13InternalHelper> ();
+        of13Helpers [s]->InstallController (controllers.Get (s), ctrls [s]);
+        Ptr<OFSwitch13Device> device = of13Helpers [s]->InstallSwitch (switches.Get (s), switchPorts [s]);
+        of13Helpers [s]->CreateOpenFlowChannels ();
+        dpIds [s] = device->GetDatapathId ();
+    }
+    uint32_t blocked = 0;
+    for (uint32_t l = 0; l < links.size (); l++)
+    {
+        if (!treeLink [l])
+        {
+            ctrls [links [l].a]->BlockPort (dpIds [links [l].a], links [l].portA);
+            ctrls [links [l].b]->BlockPort (dpIds [links [l].b], links [l].portB);
+            blocked++;
+        }
+    }
 
     // Install the TCP/IP stack into hosts nodes
     InternetStackHelper internet;
@@ -136,25 +226,43 @@ main (int argc, char *argv[])
     // Set IPv4 host addresses
     Ipv4AddressHelper ipv4helpr;
     Ipv4InterfaceContainer hostIpIfaces;
-    ipv4helpr.SetBase ("10.1.1.0", "255.255.255.0");
+    ipv4helpr.SetBase ("10.1.0.0", "255.255.0.0");
     hostIpIfaces = ipv4helpr.Assign (hostDevices);
 
-    // Configure ping application between hosts
-    V4PingHelper pingHelper = V4PingHelper (hostIpIfaces.GetAddress (1));
+    // Configure ping application between the hosts at both ends
+    V4PingHelper pingHelper = V4PingHelper (hostIpIfaces.GetAddress (nHosts - 1));
     pingHelper.SetAttribute ("Verbose", BooleanValue (true));
     ApplicationContainer pingApps = pingHelper.Install (hosts.Get (0));
     pingApps.Start (Seconds (1));
 
+    // Optionally load all switches with a traffic-matrix workload
+    Ptr<TrafficMatrixWorkload> flows;
+    if (!workload.empty ())
+    {
+        flows = Create<TrafficMatrixWorkload> ();
+        flows->SetPattern (workload);
+        flows->SetArrivalRate (flowRate);
+        flows->SetFlowSize (flowSize, 1.2, 100 * flowSize);
+        flows->Install (hosts, hostIpIfaces, Seconds (1), Seconds (simTime));
+    }
+
     // Enable datapath stats and pcap traces at hosts, switch(es), and controller(s)
+    Ptr<PcapngCaptureSink> capture;
     if (trace)
     {
-        of13Helper0->EnableOpenFlowPcap ("openflow-0");
-        of13Helper0->EnableDatapathStats ("switch-stats");
-        of13Helper1->EnableOpenFlowPcap ("openflow-1");
-        of13Helper1->EnableDatapathStats ("switch-stats");
-        csmaHelper.EnablePcap ("switch", switchPorts [0], true);
-        csmaHelper.EnablePcap ("switch", switchPorts [1], true);
-        csmaHelper.EnablePcap ("host", hostDevices);
+        capture = Create<PcapngCaptureSink> ("controller_per_switch.pcapng");
+        capture->SetSnapLen (snapLen);
+        capture->SetSampling (sampleFlows ? PcapngCaptureSink::SAMPLE_FLOWS : PcapngCaptureSink::SAMPLE_PACKETS,
+                              sampleRate);
+        for (uint32_t s = 0; s < nSwitches; s++)
+        {
+            std::ostringstream name;
+            name << "openflow-" << s;
+            capture->AddNodeDevices (controllers.Get (s), name.str (), true);
+            of13Helpers [s]->EnableDatapathStats ("switch-stats");
+            capture->AddDevices (switchPorts [s], "switch", true);
+        }
+        capture->AddDevices (hostDevices, "host", false);
     }
 
     // Run the simulation
@@ -162,6 +270,14 @@ main (int argc, char *argv[])
     FlowMonitorHelper flowmon;
     Ptr<FlowMonitor> monitor = flowmon.InstallAll();
     Simulator::Run ();
+    if (capture)
+    {
+        capture->Close ();
+        NS_LOG_UNCOND("Captured frames =" << capture->GetCapturedFrames ()
+                      << " dropped =" << capture->GetDroppedFrames ()
+                      << " sampled out =" << capture->GetSampledOutFrames ()
+                      << " bytes =" << capture->GetCapturedBytes ());
+    }
     int j=0;
     float AvgThroughput = 0;
     Time Jitter;
@@ -207,6 +323,19 @@ main (int argc, char *argv[])
     NS_LOG_UNCOND("End to End Delay =" << Delay);
     NS_LOG_UNCOND("End to End Jitter delay =" << Jitter);
     NS_LOG_UNCOND("Total Flod id " << j);
+    NS_LOG_UNCOND("--------Controller load (" << topology << ", " << nSwitches << " switches, "
+                  << links.size () << " links, " << blocked << " blocked)----------" << std::endl);
+    uint64_t maxPacketIns = 0;
+    uint64_t sumPacketIns = 0;
+    for (uint32_t s = 0; s < nSwitches; s++)
+    {
+        NS_LOG_UNCOND("Controller " << s << " packet-ins =" << ctrls [s]->GetPacketIns ()
+                      << " flow-mods =" << ctrls [s]->GetFlowMods ());
+        maxPacketIns = std::max (maxPacketIns, ctrls [s]->GetPacketIns ());
+        sumPacketIns += ctrls [s]->GetPacketIns ();
+    }
+    NS_LOG_UNCOND("Packet-ins mean =" << (double) sumPacketIns / nSwitches
+                  << " max =" << maxPacketIns);
     monitor->SerializeToXmlFile("manet-routing.xml", true, true);
     Simulator::Destroy ();
 }
\ No newline at end of file
@@ -0,0 +1,217 @@
+/*
+ * Packet copy accounting for OpenFlow switch ports.
+ *
+ * The OFSwitch13 datapath works on its own packet buffers: a frame received
+ * on a switch port is serialized from the ns-3 Packet into a datapath buffer
+ * for the pipeline, and every output deserializes the buffer back into a new
+ * Packet. The meter hooks each port's SwitchPortRx/SwitchPortTx traces and
+ * counts the bytes of both copies, next to what a path that materializes
+ * only the headers the pipeline matches on would copy, and the forwarding
+ * rate of each switch. The header length is taken from each frame: the
+ * Ethernet and IPv4 headers plus the TCP, UDP or ICMP header when the frame
+ * carries it, that is, on unfragmented packets and first fragments only.
+ * The counters are kept per traffic class, so fragmented UDP payloads show
+ * apart from TCP.
+ */
+
+#ifndef DATAPATH_COPIES_H
+#define DATAPATH_COPIES_H
+
+#include <ns3/core-module.h>
+#include <ns3/network-module.h>
+#include <ns3/ofswitch13-module.h>
+
+#include <algorithm>
+#include <array>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Counts the bytes copied in and out of the datapath buffers of switches.
+ */
+class DatapathCopyMeter : public SimpleRefCount<DatapathCopyMeter>
+{
+  public:
+    /** Traffic classes of the report. */
+    enum TrafficClass
+    {
+        TCP,      //!< TCP segments
+        UDP,      //!< Unfragmented UDP datagrams and first fragments
+        FRAGMENT, //!< Non-first IPv4 fragments, no L4 header
+        OTHER,    //!< ICMP, other IPv4 protocols, ARP and other frames
+        N_CLASSES
+    };
+
+    DatapathCopyMeter()
+    {
+    }
+
+    /**
+     * Meter all ports of a switch.
+     * \param device The OpenFlow switch device.
+     * \param name The switch name used in the report.
+     */
+    void AddSwitch(Ptr<OFSwitch13Device> device, std::string name)
+    {
+        uint32_t idx = m_switches.size();
+        m_switches.push_back({name});
+        for (uint32_t no = 1; no <= device->GetNSwitchPorts(); no++)
+        {
+            Ptr<OFSwitch13Port> port = device->GetSwitchPort(no);
+            port->TraceConnectWithoutContext(
+                "SwitchPortRx",
+                MakeBoundCallback(&DatapathCopyMeter::CopyIn, this, idx));
+            port->TraceConnectWithoutContext(
+                "SwitchPortTx",
+                MakeBoundCallback(&DatapathCopyMeter::CopyOut, this, idx));
+        }
+    }
+
+    /**
+     * Print per switch the bytes copied per forwarded packet, now and with
+     * headers only, and the forwarding rate over the time it forwarded.
+     */
+    void Report() const
+    {
+        static const char* names[N_CLASSES] = {"tcp", "udp", "fragments", "other"};
+        for (const auto& sw : m_switches)
+        {
+            if (!sw.txPackets)
+            {
+                continue;
+            }
+            uint64_t copied = sw.rxBytes + sw.txBytes;
+            uint64_t headers = sw.rxHeaderBytes + sw.txHeaderBytes;
+            double busy = (sw.lastTx - sw.firstTx).GetSeconds();
+            NS_LOG_UNCOND("Switch " << sw.name << " packets in =" << sw.rxPackets
+                                    << " forwarded =" << sw.txPackets
+                                    << " bytes copied =" << copied << " headers only ="
+                                    << headers);
+            NS_LOG_UNCOND("Switch " << sw.name << " bytes copied per forwarded packet ="
+                                    << copied / sw.txPackets << " headers only ="
+                                    << headers / sw.txPackets << " throughput ="
+                                    << (busy > 0 ? sw.txPackets / busy : 0) << " packets/s");
+            for (uint32_t c = 0; c < N_CLASSES; c++)
+            {
+                const ClassCopies& cls = sw.classes[c];
+                if (!cls.txPackets)
+                {
+                    continue;
+                }
+                NS_LOG_UNCOND("Switch " << sw.name << " " << names[c]
+                                        << " forwarded =" << cls.txPackets
+                                        << " bytes copied per forwarded packet ="
+                                        << cls.bytes / cls.txPackets << " headers only ="
+                                        << cls.headerBytes / cls.txPackets);
+            }
+        }
+    }
+
+  private:
+    /** Copies of one traffic class, in and out. */
+    struct ClassCopies
+    {
+        uint64_t txPackets{0};
+        uint64_t bytes{0};
+        uint64_t headerBytes{0};
+    };
+
+    /** Counters of one switch. */
+    struct SwitchCopies
+    {
+        std::string name;
+        uint64_t rxPackets{0};
+        uint64_t rxBytes{0};
+        uint64_t rxHeaderBytes{0};
+        uint64_t txPackets{0};
+        uint64_t txBytes{0};
+        uint64_t txHeaderBytes{0};
+        Time firstTx;
+        Time lastTx;
+        std::array<ClassCopies, N_CLASSES> classes;
+    };
+
+    /**
+     * Find the headers of a frame from its bytes.
+     * \param packet The frame, starting with the Ethernet header.
+     * \param headerBytes Set to the Ethernet, IPv4 and L4 header bytes.
+     * \return the traffic class.
+     */
+    static TrafficClass Classify(Ptr<const Packet> packet, uint32_t& headerBytes)
+    {
+        uint8_t hdr[18 + 60 + 20];
+        uint32_t len = packet->CopyData(hdr, sizeof(hdr));
+        uint32_t ip = 14;
+        if (len >= 18 && hdr[12] == 0x81 && hdr[13] == 0x00)
+        {
+            ip = 18;
+        }
+        if (len < ip + 20 || hdr[ip - 2] != 0x08 || hdr[ip - 1] != 0x00)
+        {
+            // Not IPv4: ARP and the like are all headers.
+            headerBytes = ip + 28;
+            return OTHER;
+        }
+        uint32_t ihl = (hdr[ip] & 0x0f) * 4;
+        uint8_t proto = hdr[ip + 9];
+        uint32_t l4 = ip + ihl;
+        if (((hdr[ip + 6] & 0x1f) | hdr[ip + 7]) != 0)
+        {
+            headerBytes = l4;
+            return FRAGMENT;
+        }
+        if (proto == 6)
+        {
+            headerBytes = l4 + (len >= l4 + 13 ? (hdr[l4 + 12] >> 4) * 4 : 20);
+            return TCP;
+        }
+        if (proto == 17)
+        {
+            headerBytes = l4 + 8;
+            return UDP;
+        }
+        headerBytes = l4 + (proto == 1 ? 8 : 0);
+        return OTHER;
+    }
+
+    static void CopyIn(DatapathCopyMeter* meter, uint32_t idx, Ptr<const Packet> packet)
+    {
+        SwitchCopies& sw = meter->m_switches[idx];
+        uint32_t headerBytes;
+        ClassCopies& cls = sw.classes[Classify(packet, headerBytes)];
+        headerBytes = std::min(headerBytes, packet->GetSize());
+        sw.rxPackets++;
+        sw.rxBytes += packet->GetSize();
+        sw.rxHeaderBytes += headerBytes;
+        cls.bytes += packet->GetSize();
+        cls.headerBytes += headerBytes;
+    }
+
+    static void CopyOut(DatapathCopyMeter* meter, uint32_t idx, Ptr<const Packet> packet)
+    {
+        SwitchCopies& sw = meter->m_switches[idx];
+        if (!sw.txPackets)
+        {
+            sw.firstTx = Simulator::Now();
+        }
+        sw.lastTx = Simulator::Now();
+        uint32_t headerBytes;
+        ClassCopies& cls = sw.classes[Classify(packet, headerBytes)];
+        headerBytes = std::min(headerBytes, packet->GetSize());
+        sw.txPackets++;
+        sw.txBytes += packet->GetSize();
+        sw.txHeaderBytes += headerBytes;
+        cls.txPackets++;
+        cls.bytes += packet->GetSize();
+        cls.headerBytes += headerBytes;
+    }
+
+    std::vector<SwitchCopies> m_switches;
+};
+
+} // namespace ns3
+
+#endif /* DATAPATH_COPIES_H */
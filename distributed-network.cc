@@ -7,34 +7,14 @@
 #include <ns3/ipv4-global-routing-helper.h>
 #include <ns3/flow-monitor-module.h>
 
+#include "app-counters.h"
+
 using namespace ns3;
 
-uint32_t total_client_tx = 0;
-uint32_t total_client_rx = 0;
-uint32_t total_server_tx = 0;
-uint32_t total_server_rx = 0;
 uint32_t SentPackets = 0;
 uint32_t ReceivedPackets = 0;
 uint32_t LostPackets = 0;
 
-
-void ClientTx (std::string context, Ptr<const Packet> packet)
-{
-  total_client_tx++;
-}
-void ClientRx (std::string context, Ptr<const Packet> packet)
-{
-  total_client_rx++;
-}
-void ServerTx (std::string context, Ptr<const Packet> packet)
-{
-  total_server_tx++;
-}
-void ServerRx (std::string context, Ptr<const Packet> packet)
-{
-  total_server_rx++;
-}
-
 int
 main (int argc, char *argv[])
 {
@@ -128,6 +108,12 @@ main (int argc, char *argv[])
   clientApps.Start (Seconds (1));
   clientApps.Stop (Seconds (10));
   
+  //Count application packets per node, clients and servers apart
+  Ptr<AppCounters> clientCounters = Create<AppCounters> ();
+  clientCounters->Attach (clientApps);
+  Ptr<AppCounters> serverCounters = Create<AppCounters> ();
+  serverCounters->Attach (serverApps);
+
   //For routers to be able to forward packets, they need to have routing rules.
   Ipv4GlobalRoutingHelper::PopulateRoutingTables ();
 
@@ -136,8 +122,10 @@ main (int argc, char *argv[])
   FlowMonitorHelper flowmon;
   Ptr<FlowMonitor> monitor = flowmon.InstallAll();  Simulator::Run ();
 
-  std::cout << "Client Tx: " << total_client_tx << "\tClient Rx: " << total_client_rx << std::endl;
-  std::cout << "Server Rx: " << total_server_rx << std::endl;
+  std::cout << "Client Tx: " << clientCounters->GetTxPackets ()
+            << "\tClient Rx: " << clientCounters->GetRxPackets () << std::endl;
+  std::cout << "Server Rx: " << serverCounters->GetRxPackets ()
+            << "\tServer Tx: " << serverCounters->GetTxPackets () << std::endl;
   int j=0;
     float AvgThroughput = 0;
     Time Jitter;
@@ -7,6 +7,9 @@
 #include <ns3/flow-monitor-module.h>
 #include <ns3/applications-module.h>
 
+#include "flow-completion.h"
+#include "pcapng-capture.h"
+
 using namespace ns3;
 
 int
@@ -15,6 +18,10 @@ main(int argc, char* argv[])
     uint16_t simTime = 1000;
     bool verbose = false;
     bool trace = false;
+    uint32_t snapLen = 0;
+    uint32_t sampleRate = 1;
+    bool sampleFlows = false;
+    uint32_t flowBytes = 1000000;
     uint32_t SentPackets = 0;
     uint32_t ReceivedPackets = 0;
     uint32_t LostPackets = 0;
@@ -24,6 +31,10 @@ main(int argc, char* argv[])
     cmd.AddValue("simTime", "Simulation time (seconds)", simTime);
     cmd.AddValue("verbose", "Enable verbose output", verbose);
     cmd.AddValue("trace", "Enable datapath stats and pcap traces", trace);
+    cmd.AddValue("snapLen", "Captured bytes per frame (0 for full frames)", snapLen);
+    cmd.AddValue("sampleRate", "Capture one in N packets (or flows)", sampleRate);
+    cmd.AddValue("sampleFlows", "Sample whole flows instead of packets", sampleFlows);
+    cmd.AddValue("flowBytes", "Size of the timed TCP transfer (bytes)", flowBytes);
     cmd.Parse(argc, argv);
 
     if (verbose)
@@ -105,27 +116,39 @@ main(int argc, char* argv[])
     ipv4.SetBase ("10.1.1.0", "255.255.255.0");
     ipv4.Assign (hostDevices);
     
-    
-    // Create an OnOff application to send UDP datagrams from n0 to n1.
-    uint16_t port = 9;   // Discard port (RFC 863)
-    OnOffHelper onoff ("ns3::TcpSocketFactory",
-                       Address (InetSocketAddress (Ipv4Address ("10.1.1.40"), port)));
-    onoff.SetConstantRate (DataRate ("10kb/s"));
-    ApplicationContainer app = onoff.Install (hosts.Get (0));
-    // Start the application
+
+    // Send a finite TCP transfer from host 0 to a host in the other domain
+    uint16_t port = 9;
+    BulkSendHelper bulk ("ns3::TcpSocketFactory",
+                         Address (InetSocketAddress (Ipv4Address ("10.1.1.40"), port)));
+    bulk.SetAttribute ("MaxBytes", UintegerValue (flowBytes));
+    ApplicationContainer app = bulk.Install (hosts.Get (0));
     app.Start (Seconds (1.0));
-    app.Stop (Seconds (10.0));
+
+    PacketSinkHelper sinkHelper ("ns3::TcpSocketFactory",
+                                 Address (InetSocketAddress (Ipv4Address::GetAny (), port)));
+    ApplicationContainer sinkApp = sinkHelper.Install (hosts.Get (39));
+    sinkApp.Start (Seconds (0.0));
+
+    // Time the transfer end to end
+    Ptr<FctTracker> fct = Create<FctTracker> ();
+    fct->Track (DynamicCast<PacketSink> (sinkApp.Get (0)), flowBytes, Seconds (1.0));
     
     // Enable datapath stats and pcap traces at hosts, switch(es), and controller(s)
+    Ptr<PcapngCaptureSink> capture;
     if (trace)
     {
-        of13Helper0->EnableOpenFlowPcap("openflow-0");
+        capture = Create<PcapngCaptureSink>("distributed-sdn-4.pcapng");
+        capture->SetSnapLen(snapLen);
+        capture->SetSampling(sampleFlows ? PcapngCaptureSink::SAMPLE_FLOWS : PcapngCaptureSink::SAMPLE_PACKETS,
+                             sampleRate);
+        capture->AddNodeDevices(controllers.Get(0), "openflow-0", true);
         of13Helper0->EnableDatapathStats("switch-stats");
-        of13Helper1->EnableOpenFlowPcap("openflow-1");
+        capture->AddNodeDevices(controllers.Get(1), "openflow-1", true);
         of13Helper1->EnableDatapathStats("switch-stats");
-        csmaHelper.EnablePcap("switch", switchPorts[0], true);
-        csmaHelper.EnablePcap("switch", switchPorts[1], true);
-        csmaHelper.EnablePcap("host", hostDevices);
+        capture->AddDevices(switchPorts[0], "switch", true);
+        capture->AddDevices(switchPorts[1], "switch", true);
+        capture->AddDevices(hostDevices, "host", false);
     }
 
     // Run the simulation
@@ -133,6 +156,14 @@ main(int argc, char* argv[])
     FlowMonitorHelper flowmon;
     Ptr<FlowMonitor> monitor = flowmon.InstallAll();
     Simulator::Run();
+    if (capture)
+    {
+        capture->Close();
+        NS_LOG_UNCOND("Captured frames =" << capture->GetCapturedFrames()
+                      << " dropped =" << capture->GetDroppedFrames()
+                      << " sampled out =" << capture->GetSampledOutFrames()
+                      << " bytes =" << capture->GetCapturedBytes());
+    }
         int j=0;
     float AvgThroughput = 0;
     Time Jitter;
@@ -178,6 +209,8 @@ main(int argc, char* argv[])
     NS_LOG_UNCOND("End to End Delay =" << Delay);
     NS_LOG_UNCOND("End to End Jitter delay =" << Jitter);
     NS_LOG_UNCOND("Total Flod id " << j);
+    fct->Report();
+    fct->WriteFlows("fct-4.txt");
     monitor->SerializeToXmlFile("manet-routing.xml", true, true);    
     Simulator::Destroy();
 }
@@ -7,6 +7,9 @@
 #include <ns3/flow-monitor-module.h>
 #include <ns3/applications-module.h>
 
+#include "pcapng-capture.h"
+#include "request-response.h"
+
 using namespace ns3;
 
 int
@@ -15,6 +18,13 @@ main(int argc, char* argv[])
     uint16_t simTime = 1000;
     bool verbose = false;
     bool trace = false;
+    uint32_t snapLen = 0;
+    uint32_t sampleRate = 1;
+    bool sampleFlows = false;
+    uint32_t nClients = 100;
+    uint32_t nServers = 100;
+    uint32_t requestSize = 10240;
+    uint32_t responseSize = 10240;
     uint32_t SentPackets = 0;
     uint32_t ReceivedPackets = 0;
     uint32_t LostPackets = 0;
@@ -24,6 +34,13 @@ main(int argc, char* argv[])
     cmd.AddValue("simTime", "Simulation time (seconds)", simTime);
     cmd.AddValue("verbose", "Enable verbose output", verbose);
     cmd.AddValue("trace", "Enable datapath stats and pcap traces", trace);
+    cmd.AddValue("snapLen", "Captured bytes per frame (0 for full frames)", snapLen);
+    cmd.AddValue("sampleRate", "Capture one in N packets (or flows)", sampleRate);
+    cmd.AddValue("sampleFlows", "Sample whole flows instead of packets", sampleFlows);
+    cmd.AddValue("clients", "Number of request/response clients, attached to switch 0", nClients);
+    cmd.AddValue("servers", "Number of servers, attached to switch 1", nServers);
+    cmd.AddValue("requestSize", "Request size (bytes)", requestSize);
+    cmd.AddValue("responseSize", "Response size (bytes)", responseSize);
     cmd.Parse(argc, argv);
 
     if (verbose)
@@ -43,9 +60,12 @@ main(int argc, char* argv[])
     // Enable checksum computations (required by OFSwitch13 module)
     GlobalValue::Bind("ChecksumEnabled", BooleanValue(true));
 
-    // Create two host nodes
-    NodeContainer hosts;
-    hosts.Create(200);
+    // Create the client and server host nodes
+    NodeContainer clientNodes;
+    clientNodes.Create(nClients);
+    NodeContainer serverNodes;
+    serverNodes.Create(nServers);
+    NodeContainer hosts(clientNodes, serverNodes);
 
     // Create two switch nodes
     NodeContainer switches;
@@ -63,14 +83,14 @@ main(int argc, char* argv[])
     switchPorts[0] = NetDeviceContainer();
     switchPorts[1] = NetDeviceContainer();
 
-    for (int i = 0; i < 100; ++i) {
-        NodeContainer pair = NodeContainer(hosts.Get(i), switches.Get(0));
+    for (uint32_t i = 0; i < nClients; ++i) {
+        NodeContainer pair = NodeContainer(clientNodes.Get(i), switches.Get(0));
         NetDeviceContainer pairDevs = csmaHelper.Install(pair);
         hostDevices.Add(pairDevs.Get(0));
         switchPorts[0].Add(pairDevs.Get(1));
      }
-    for (int i = 100; i < 200; ++i) {
-        NodeContainer pair = NodeContainer(hosts.Get(i), switches.Get(1));
+    for (uint32_t i = 0; i < nServers; ++i) {
+        NodeContainer pair = NodeContainer(serverNodes.Get(i), switches.Get(1));
         NetDeviceContainer pairDevs = csmaHelper.Install(pair);
         hostDevices.Add(pairDevs.Get(0));
         switchPorts[1].Add(pairDevs.Get(1));
@@ -100,41 +120,38 @@ main(int argc, char* argv[])
     InternetStackHelper internet;
     internet.Install(hosts);
 
-    // Set IPv4 host addresses
+    // Set IPv4 host addresses (a /16, so 1000+ clients fit in one subnet)
     Ipv4AddressHelper ipv4;
-    ipv4.SetBase ("10.1.1.0", "255.255.255.0");
-    ipv4.Assign (hostDevices);
-      
-    UdpEchoServerHelper echoServer (9);
-    for (i = 100, i < 200, i++){
-      ApplicationContainer serverApps = echoServer.Install (hosts.Get(i));
-      serverApps.Start (Seconds (0));
-      serverApps.Stop (Seconds (10));
-    }
-  
-  
-    UdpEchoClientHelper echoClient (hosts.Get(1) (0), 9);    
-    echoClient.SetAttribute ("MaxPackets", UintegerValue (100));
-    echoClient.SetAttribute ("Interval", TimeValue (MilliSeconds (200)));
-    echoClient.SetAttribute ("PacketSize", UintegerValue (10240));
-  
-    for (i = 0, i < 100, i++){
-      NodeContainer clientNodes (hosts.Get(i));
+    ipv4.SetBase ("10.1.0.0", "255.255.0.0");
+    Ipv4InterfaceContainer hostIpIfaces = ipv4.Assign (hostDevices);
+    Ipv4InterfaceContainer serverIpIfaces;
+    for (uint32_t i = 0; i < nServers; ++i) {
+        serverIpIfaces.Add(hostIpIfaces.Get(nClients + i));
     }
-    ApplicationContainer clientApps = echoClient.Install (clientNodes);
-    clientApps.Start (Seconds (0));
-    clientApps.Stop (Seconds (10));
+
+    // Client i sends requests to server i mod servers
+    RequestResponseHelper reqResp(9);
+    reqResp.SetClientAttribute("MaxRequests", UintegerValue(100));
+    reqResp.SetClientAttribute("Interval", TimeValue(MilliSeconds(200)));
+    reqResp.SetClientAttribute("RequestSize", UintegerValue(requestSize));
+    reqResp.SetServerAttribute("ResponseSize", UintegerValue(responseSize));
+    reqResp.Install(clientNodes, serverNodes, serverIpIfaces, Seconds(0), Seconds(10));
      
     // Enable datapath stats and pcap traces at hosts, switch(es), and controller(s)
+    Ptr<PcapngCaptureSink> capture;
     if (trace)
     {
-        of13Helper0->EnableOpenFlowPcap("openflow-0");
+        capture = Create<PcapngCaptureSink>("distributed-sdn-new.pcapng");
+        capture->SetSnapLen(snapLen);
+        capture->SetSampling(sampleFlows ? PcapngCaptureSink::SAMPLE_FLOWS : PcapngCaptureSink::SAMPLE_PACKETS,
+                             sampleRate);
+        capture->AddNodeDevices(controllers.Get(0), "openflow-0", true);
         of13Helper0->EnableDatapathStats("switch-stats");
-        of13Helper1->EnableOpenFlowPcap("openflow-1");
+        capture->AddNodeDevices(controllers.Get(1), "openflow-1", true);
         of13Helper1->EnableDatapathStats("switch-stats");
-        csmaHelper.EnablePcap("switch", switchPorts[0], true);
-        csmaHelper.EnablePcap("switch", switchPorts[1], true);
-        csmaHelper.EnablePcap("host", hostDevices);
+        capture->AddDevices(switchPorts[0], "switch", true);
+        capture->AddDevices(switchPorts[1], "switch", true);
+        capture->AddDevices(hostDevices, "host", false);
     }
 
     // Run the simulation
@@ -142,6 +159,14 @@ main(int argc, char* argv[])
     FlowMonitorHelper flowmon;
     Ptr<FlowMonitor> monitor = flowmon.InstallAll();
     Simulator::Run();
+    if (capture)
+    {
+        capture->Close();
+        NS_LOG_UNCOND("Captured frames =" << capture->GetCapturedFrames()
+                      << " dropped =" << capture->GetDroppedFrames()
+                      << " sampled out =" << capture->GetSampledOutFrames()
+                      << " bytes =" << capture->GetCapturedBytes());
+    }
         int j=0;
     float AvgThroughput = 0;
     Time Jitter;
@@ -187,6 +212,8 @@ main(int argc, char* argv[])
     NS_LOG_UNCOND("End to End Delay =" << Delay);
     NS_LOG_UNCOND("End to End Jitter delay =" << Jitter);
     NS_LOG_UNCOND("Total Flod id " << j);
+    reqResp.GetRecorder()->Report();
+    reqResp.GetRecorder()->WriteSamples("rtt.txt");
     monitor->SerializeToXmlFile("manet-routing.xml", true, true);    
     Simulator::Destroy();
 }
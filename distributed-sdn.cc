@@ -7,14 +7,56 @@
 #include <ns3/flow-monitor-module.h>
 #include <ns3/applications-module.h>
 
+#include "control-network.h"
+#include "datapath-copies.h"
+#include "domain-controller.h"
+#include "fault-injector.h"
+#include "flow-completion.h"
+#include "pcap-replay.h"
+#include "pcapng-capture.h"
+#include "queue-monitor.h"
+#include "static-arp.h"
+#include "traffic-matrix.h"
+
 using namespace ns3;
 
+/** Count the packets and bytes sent or received by a controller's OpenFlow channel. */
+static void
+CountChannelBytes(uint64_t* packets, uint64_t* bytes, Ptr<const Packet> packet)
+{
+    (*packets)++;
+    *bytes += packet->GetSize();
+}
+
 int
 main(int argc, char* argv[])
 {
     uint16_t simTime = 1000;
     bool verbose = false;
     bool trace = false;
+    uint32_t snapLen = 0;
+    uint32_t sampleRate = 1;
+    bool sampleFlows = false;
+    uint32_t nHosts = 10;
+    std::string workload;
+    double flowRate = 100;
+    uint32_t flowSize = 100000;
+    std::string replay;
+    bool altPath = false;
+    std::string faults;
+    bool redundant = false;
+    double killMaster = 0;
+    double tableStats = 0;
+    bool aggregate = false;
+    bool arpProxy = false;
+    bool warm = false;
+    double queueStats = 0;
+    uint32_t missSendLen = 128;
+    double flowModBatch = 0;
+    bool copyStats = false;
+    std::string ctrlNetRate;
+    double ctrlNetDelay = 0.1;
+    double ctrl1Delay = -1;
     uint32_t SentPackets = 0;
     uint32_t ReceivedPackets = 0;
     uint32_t LostPackets = 0;
@@ -24,8 +66,60 @@ main(int argc, char* argv[])
     cmd.AddValue("simTime", "Simulation time (seconds)", simTime);
     cmd.AddValue("verbose", "Enable verbose output", verbose);
     cmd.AddValue("trace", "Enable datapath stats and pcap traces", trace);
+    cmd.AddValue("snapLen", "Captured bytes per frame (0 for full frames)", snapLen);
+    cmd.AddValue("sampleRate", "Capture one in N packets (or flows)", sampleRate);
+    cmd.AddValue("sampleFlows", "Sample whole flows instead of packets", sampleFlows);
+    cmd.AddValue("hosts", "Number of hosts, split evenly between the two domains", nHosts);
+    cmd.AddValue("workload",
+                 "Traffic matrix: uniform, permutation, hotspot, incast or a matrix file "
+                 "(empty for the single OnOff flow)",
+                 workload);
+    cmd.AddValue("flowRate", "Workload flow arrival rate (flows/s)", flowRate);
+    cmd.AddValue("flowSize", "Mean workload flow size (bytes)", flowSize);
+    cmd.AddValue("replay", "Replay the IPv4 traffic of this pcap file from the hosts", replay);
+    cmd.AddValue("altPath", "Add a standby inter-switch link for failover", altPath);
+    cmd.AddValue("faults",
+                 "Fault schedule, e.g. link0:down@3,link0:up@6 (targets: link0, link1, s<i>p<n>)",
+                 faults);
+    cmd.AddValue("redundant",
+                 "Connect both switches to both controllers with master/slave roles",
+                 redundant);
+    cmd.AddValue("killMaster", "Kill controller 0 at this time in seconds (0 to disable)", killMaster);
+    cmd.AddValue("tableStats",
+                 "Flow table sampling period in seconds, written to table-stats-<n>.txt (0 to disable)",
+                 tableStats);
+    cmd.AddValue("aggregate",
+                 "Address each domain from its own /25 and route it with one prefix entry",
+                 aggregate);
+    cmd.AddValue("arpProxy", "Answer ARP requests in the controllers instead of flooding", arpProxy);
+    cmd.AddValue("warm",
+                 "Pre-populate ARP caches and switch flow tables before the run",
+                 warm);
+    cmd.AddValue("queueStats",
+                 "Switch port queue sampling period in seconds, written to queue-*.csv (0 to disable)",
+                 queueStats);
+    cmd.AddValue("missSendLen",
+                 "Table-miss bytes sent to the controller, the rest buffered in the switch "
+                 "(65535 sends whole packets)",
+                 missSendLen);
+    cmd.AddValue("flowModBatch",
+                 "Window for batching learned flow-mods per switch behind a barrier (ms, 0 to disable)",
+                 flowModBatch);
+    cmd.AddValue("copyStats",
+                 "Report the bytes copied into and out of the datapath per forwarded packet",
+                 copyStats);
+    cmd.AddValue("ctrlNetRate",
+                 "Carry the OpenFlow channels over a shared management LAN of this link rate "
+                 "(empty for the helpers' ideal channels)",
+                 ctrlNetRate);
+    cmd.AddValue("ctrlNetDelay", "One-way delay of each management LAN link (ms)", ctrlNetDelay);
+    cmd.AddValue("ctrl1Delay",
+                 "One-way delay of controller 1's management link (ms, default ctrlNetDelay)",
+                 ctrl1Delay);
     cmd.Parse(argc, argv);
 
+    NS_ABORT_MSG_IF(missSendLen > OFPCML_NO_BUFFER, "missSendLen is at most 65535");
+
     if (verbose)
     {
         OFSwitch13Helper::EnableDatapathLogs();
@@ -43,9 +137,9 @@ main(int argc, char* argv[])
     // Enable checksum computations (required by OFSwitch13 module)
     GlobalValue::Bind("ChecksumEnabled", BooleanValue(true));
 
-    // Create two host nodes
+    // Create the host nodes
     NodeContainer hosts;
-    hosts.Create(10);
+    hosts.Create(nHosts);
 
     // Create two switch nodes
     NodeContainer switches;
@@ -63,13 +157,13 @@ main(int argc, char* argv[])
     switchPorts[0] = NetDeviceContainer();
     switchPorts[1] = NetDeviceContainer();
 
-    for (int i = 0; i < 5; ++i) {
+    for (uint32_t i = 0; i < nHosts / 2; ++i) {
         NodeContainer pair = NodeContainer(hosts.Get(i), switches.Get(0));
         NetDeviceContainer pairDevs = csmaHelper.Install(pair);
         hostDevices.Add(pairDevs.Get(0));
         switchPorts[0].Add(pairDevs.Get(1));
      }
-    for (int i = 5; i < 10; ++i) {
+    for (uint32_t i = nHosts / 2; i < nHosts; ++i) {
         NodeContainer pair = NodeContainer(hosts.Get(i), switches.Get(1));
         NetDeviceContainer pairDevs = csmaHelper.Install(pair);
         hostDevices.Add(pairDevs.Get(0));
@@ -81,21 +175,156 @@ main(int argc, char* argv[])
     pairDevs = csmaHelper.Install(pair);
     switchPorts[0].Add(pairDevs.Get(0));
     switchPorts[1].Add(pairDevs.Get(1));
+    uint32_t islPort[2] = {switchPorts[0].GetN(), switchPorts[1].GetN()};
+
+    // Optionally add a redundant link, kept on standby by the controllers
+    if (altPath)
+    {
+        pairDevs = csmaHelper.Install(pair);
+        switchPorts[0].Add(pairDevs.Get(0));
+        switchPorts[1].Add(pairDevs.Get(1));
+    }
 
     // Create two controller nodes
     NodeContainer controllers;
     controllers.Create(2);
 
     // Configure both OpenFlow network domains
+    Ptr<DomainController> ctrl0 = CreateObject<DomainController>();
+    Ptr<DomainController> ctrl1 = CreateObject<DomainController>();
     Ptr<OFSwitch13InternalHelper> of13Helper0 = CreateObject<OFSwitch13InternalHelper>();
-    of13Helper0->InstallController(controllers.Get(0));
-    of13Helper0->InstallSwitch(switches.Get(0), switchPorts[0]);
-    of13Helper0->CreateOpenFlowChannels();
-
     Ptr<OFSwitch13InternalHelper> of13Helper1 = CreateObject<OFSwitch13InternalHelper>();
-    of13Helper1->InstallController(controllers.Get(1));
-    of13Helper1->InstallSwitch(switches.Get(1), switchPorts[1]);
-    of13Helper1->CreateOpenFlowChannels();
+    Ptr<OFSwitch13Device> switch0;
+    Ptr<OFSwitch13Device> switch1;
+    if (redundant)
+    {
+        // Each controller is master of its own domain and slave of the other
+        of13Helper0->InstallController(controllers.Get(0), ctrl0);
+        of13Helper0->InstallController(controllers.Get(1), ctrl1);
+        switch0 = of13Helper0->InstallSwitch(switches.Get(0), switchPorts[0]);
+        switch1 = of13Helper0->InstallSwitch(switches.Get(1), switchPorts[1]);
+
+        ctrl0->SetRole(switch0->GetDatapathId(), DomainController::MASTER);
+        ctrl0->SetRole(switch1->GetDatapathId(), DomainController::SLAVE);
+        ctrl1->SetRole(switch0->GetDatapathId(), DomainController::SLAVE);
+        ctrl1->SetRole(switch1->GetDatapathId(), DomainController::MASTER);
+        ctrl0->AddPeer(ctrl1);
+        ctrl1->AddPeer(ctrl0);
+    }
+    else
+    {
+        of13Helper0->InstallController(controllers.Get(0), ctrl0);
+        switch0 = of13Helper0->InstallSwitch(switches.Get(0), switchPorts[0]);
+
+        of13Helper1->InstallController(controllers.Get(1), ctrl1);
+        switch1 = of13Helper1->InstallSwitch(switches.Get(1), switchPorts[1]);
+    }
+
+    // Connect switches and controllers over the helpers' channels or a
+    // shared out-of-band management LAN
+    Ptr<ControlNetwork> ctrlNet;
+    if (!ctrlNetRate.empty())
+    {
+        ctrlNet = Create<ControlNetwork>();
+        ctrlNet->SetLinkRate(DataRate(ctrlNetRate));
+        ctrlNet->SetLinkDelay(MicroSeconds(ctrlNetDelay * 1000));
+        if (ctrl1Delay >= 0)
+        {
+            ctrlNet->SetNodeDelay(controllers.Get(1), MicroSeconds(ctrl1Delay * 1000));
+        }
+        ctrlNet->Connect(switch0, ctrl0);
+        ctrlNet->Connect(switch1, ctrl1);
+        if (redundant)
+        {
+            ctrlNet->Connect(switch0, ctrl1);
+            ctrlNet->Connect(switch1, ctrl0);
+        }
+        ctrlNet->Install();
+    }
+    else
+    {
+        of13Helper0->CreateOpenFlowChannels();
+        if (!redundant)
+        {
+            of13Helper1->CreateOpenFlowChannels();
+        }
+    }
+    if (redundant)
+    {
+        // Heartbeats travel over the control network, between the
+        // controllers' OpenFlow channel addresses
+        Ipv4Address ctrlAddr[2];
+        for (uint32_t c = 0; c < 2; c++)
+        {
+            ctrlAddr[c] = controllers.Get(c)->GetObject<Ipv4>()->GetAddress(1, 0).GetLocal();
+        }
+        ctrl0->AddHeartbeatPeer(ctrlAddr[1]);
+        ctrl1->AddHeartbeatPeer(ctrlAddr[0]);
+        ctrl0->StartHeartbeat(MilliSeconds(100), 3);
+        ctrl1->StartHeartbeat(MilliSeconds(100), 3);
+    }
+    ctrl0->SetMissSendLen(missSendLen);
+    ctrl1->SetMissSendLen(missSendLen);
+    ctrl0->SetFlowModBatching(MicroSeconds(flowModBatch * 1000));
+    ctrl1->SetFlowModBatching(MicroSeconds(flowModBatch * 1000));
+
+    // Meter the OpenFlow channels at the controller nodes
+    uint64_t ctrlRxPackets = 0;
+    uint64_t ctrlRxBytes = 0;
+    uint64_t ctrlTxPackets = 0;
+    uint64_t ctrlTxBytes = 0;
+    for (uint32_t c = 0; c < controllers.GetN(); c++)
+    {
+        for (uint32_t d = 0; d < controllers.Get(c)->GetNDevices(); d++)
+        {
+            Ptr<NetDevice> device = controllers.Get(c)->GetDevice(d);
+            device->TraceConnectWithoutContext(
+                "MacRx",
+                MakeBoundCallback(&CountChannelBytes, &ctrlRxPackets, &ctrlRxBytes));
+            device->TraceConnectWithoutContext(
+                "MacTx",
+                MakeBoundCallback(&CountChannelBytes, &ctrlTxPackets, &ctrlTxBytes));
+        }
+    }
+
+    if (arpProxy)
+    {
+        // The controllers share their host tables
+        ctrl0->SetArpProxy(true);
+        ctrl1->SetArpProxy(true);
+        if (!redundant)
+        {
+            ctrl0->AddPeer(ctrl1);
+            ctrl1->AddPeer(ctrl0);
+        }
+    }
+    if (aggregate)
+    {
+        NS_ABORT_MSG_IF(nHosts - nHosts / 2 > 126, "Aggregation supports up to 126 hosts per domain");
+        ctrl0->AddPrefixRoute(switch0->GetDatapathId(),
+                              Ipv4Address("10.1.1.128"),
+                              Ipv4Mask("255.255.255.128"),
+                              islPort[0]);
+        ctrl1->AddPrefixRoute(switch1->GetDatapathId(),
+                              Ipv4Address("10.1.1.0"),
+                              Ipv4Mask("255.255.255.128"),
+                              islPort[1]);
+    }
+    if (tableStats > 0)
+    {
+        ctrl0->StartTableStats(Seconds(tableStats), "table-stats-0.txt");
+        ctrl1->StartTableStats(Seconds(tableStats), "table-stats-1.txt");
+    }
+    if (killMaster > 0)
+    {
+        Simulator::Schedule(Seconds(killMaster), &DomainController::Kill, ctrl0);
+    }
+
+    if (altPath)
+    {
+        ctrl0->SetStandbyPort(switch0->GetDatapathId(), islPort[0], islPort[0] + 1);
+        ctrl1->SetStandbyPort(switch1->GetDatapathId(), islPort[1], islPort[1] + 1);
+    }
     
     InternetStackHelper internet;
     internet.Install(hosts);
@@ -103,31 +332,153 @@ main(int argc, char* argv[])
     // Set IPv4 host addresses
     Ipv4AddressHelper ipv4;
     ipv4.SetBase ("10.1.1.0", "255.255.255.0");
-    ipv4.Assign (hostDevices);
-    
-    // Create an OnOffHelper to send UDP packets from Switch 0 to Switch 1
-    uint16_t port = 9; // Discard port (RFC 863)
-    OnOffHelper onoff ("ns3::UdpSocketFactory",
-                   Address (InetSocketAddress (Ipv4Address (hosts.Get(6)), port)));
-    onoff.SetAttribute ("PacketSize", UintegerValue (10240));
-
-    // Install the OnOff application on Switch 0
-    ApplicationContainer app = onoff.Install (hosts.Get (0));
-
-    // Start the application
-    app.Start (Seconds (1.0));
-    app.Stop (Seconds (10.0));
+    Ipv4InterfaceContainer hostIpIfaces;
+    if (aggregate)
+    {
+        // Same subnet, but domain 0 in the lower and domain 1 in the upper half
+        NetDeviceContainer domainDevices[2];
+        for (uint32_t i = 0; i < nHosts; i++)
+        {
+            domainDevices[i < nHosts / 2 ? 0 : 1].Add(hostDevices.Get(i));
+        }
+        hostIpIfaces.Add(ipv4.Assign(domainDevices[0]));
+        ipv4.SetBase("10.1.1.0", "255.255.255.0", "0.0.0.129");
+        hostIpIfaces.Add(ipv4.Assign(domainDevices[1]));
+    }
+    else
+    {
+        hostIpIfaces = ipv4.Assign (hostDevices);
+    }
+
+    // Skip ARP resolution and MAC learning: fill every cache up front
+    int64_t setupWallMs = 0;
+    uint32_t arpEntries = 0;
+    if (warm)
+    {
+        SystemWallClockMs setupClock;
+        setupClock.Start();
+        arpEntries = PopulateArp(hostIpIfaces, hostDevices);
+
+        Ptr<DomainController> ctrls[2] = {ctrl0, ctrl1};
+        uint64_t dpIds[2] = {switch0->GetDatapathId(), switch1->GetDatapathId()};
+        for (uint32_t i = 0; i < nHosts; i++)
+        {
+            Mac48Address mac = Mac48Address::ConvertFrom(hostDevices.Get(i)->GetAddress());
+            Ipv4Address ip = hostIpIfaces.GetAddress(i);
+            uint32_t domain = (i < nHosts / 2) ? 0 : 1;
+            uint32_t port = (domain == 0 ? i : i - nHosts / 2) + 1;
+            ctrls[domain]->AddStaticHost(dpIds[domain], mac, port, ip);
+            ctrls[1 - domain]->AddStaticHost(dpIds[1 - domain], mac, islPort[1 - domain], ip);
+        }
+        setupWallMs = setupClock.End();
+    }
+
+    Ptr<TrafficMatrixWorkload> flows;
+    Ptr<FctTracker> fct;
+    Ptr<PcapReplayHelper> replayer;
+    if (!replay.empty())
+    {
+        // Re-originate the captured packets at their recorded offsets
+        replayer = Create<PcapReplayHelper>(replay);
+        replayer->Install(hosts, hostIpIfaces, Seconds(1.0), Seconds(simTime));
+    }
+    else if (!workload.empty())
+    {
+        // Draw Poisson arrivals of heavy-tailed TCP flows from the traffic matrix
+        flows = Create<TrafficMatrixWorkload>();
+        flows->SetPattern(workload);
+        flows->SetArrivalRate(flowRate);
+        flows->SetFlowSize(flowSize, 1.2, 100 * flowSize);
+        flows->Install(hosts, hostIpIfaces, Seconds(1.0), Seconds(10.0));
+
+        // Time every workload flow end to end
+        fct = Create<FctTracker>();
+        for (const auto& flow : flows->GetFlows())
+        {
+            fct->Track(flow.sink, flow.bytes, flow.start);
+        }
+    }
+    else
+    {
+        // Create an OnOffHelper to send UDP packets from Switch 0 to Switch 1
+        uint16_t port = 9; // Discard port (RFC 863)
+        OnOffHelper onoff ("ns3::UdpSocketFactory",
+                       Address (InetSocketAddress (hostIpIfaces.GetAddress (nHosts / 2 + 1), port)));
+        onoff.SetAttribute ("PacketSize", UintegerValue (10240));
+
+        // Install the OnOff application on Switch 0
+        ApplicationContainer app = onoff.Install (hosts.Get (0));
+
+        // Start the application
+        app.Start (Seconds (1.0));
+        app.Stop (Seconds (10.0));
+    }
         
+    Ptr<FaultInjector> faultInjector;
+    if (!faults.empty())
+    {
+        faultInjector = Create<FaultInjector>();
+        faultInjector->AddSwitch(0, switch0, switchPorts[0], ctrl0);
+        faultInjector->AddSwitch(1, switch1, switchPorts[1], ctrl1);
+        for (uint32_t l = 0; l < (altPath ? 2 : 1); l++)
+        {
+            std::ostringstream link;
+            std::ostringstream end0;
+            std::ostringstream end1;
+            link << "link" << l;
+            end0 << "s0p" << islPort[0] + l;
+            end1 << "s1p" << islPort[1] + l;
+            faultInjector->AddLink(link.str(), end0.str(), end1.str());
+        }
+        faultInjector->Schedule(faults);
+
+        // Cross-domain probe at 1000 packets/s to time the outages
+        uint16_t probePort = 5000;
+        OnOffHelper probe("ns3::UdpSocketFactory",
+                          InetSocketAddress(hostIpIfaces.GetAddress(nHosts - 1), probePort));
+        probe.SetConstantRate(DataRate("1Mbps"), 125);
+        ApplicationContainer probeApp = probe.Install(hosts.Get(1));
+        probeApp.Start(Seconds(1.0));
+        probeApp.Stop(Seconds(simTime));
+        PacketSinkHelper probeSink("ns3::UdpSocketFactory",
+                                   InetSocketAddress(Ipv4Address::GetAny(), probePort));
+        ApplicationContainer probeSinkApp = probeSink.Install(hosts.Get(nHosts - 1));
+        faultInjector->WatchTx(probeApp.Get(0));
+        faultInjector->WatchRx(DynamicCast<PacketSink>(probeSinkApp.Get(0)));
+    }
+
+    Ptr<QueueMonitor> queues;
+    if (queueStats > 0)
+    {
+        queues = Create<QueueMonitor>();
+        queues->AddSwitch(switch0, "s0");
+        queues->AddSwitch(switch1, "s1");
+        queues->StartSampling(Seconds(queueStats), "queue-depth.csv");
+    }
+
+    Ptr<DatapathCopyMeter> copies;
+    if (copyStats)
+    {
+        copies = Create<DatapathCopyMeter>();
+        copies->AddSwitch(switch0, "s0");
+        copies->AddSwitch(switch1, "s1");
+    }
+
     // Enable datapath stats and pcap traces at hosts, switch(es), and controller(s)
+    Ptr<PcapngCaptureSink> capture;
     if (trace)
     {
-        of13Helper0->EnableOpenFlowPcap("openflow-0");
+        capture = Create<PcapngCaptureSink>("distributed-sdn.pcapng");
+        capture->SetSnapLen(snapLen);
+        capture->SetSampling(sampleFlows ? PcapngCaptureSink::SAMPLE_FLOWS : PcapngCaptureSink::SAMPLE_PACKETS,
+                             sampleRate);
+        capture->AddNodeDevices(controllers.Get(0), "openflow-0", true);
         of13Helper0->EnableDatapathStats("switch-stats");
-        of13Helper1->EnableOpenFlowPcap("openflow-1");
+        capture->AddNodeDevices(controllers.Get(1), "openflow-1", true);
         of13Helper1->EnableDatapathStats("switch-stats");
-        csmaHelper.EnablePcap("switch", switchPorts[0], true);
-        csmaHelper.EnablePcap("switch", switchPorts[1], true);
-        csmaHelper.EnablePcap("host", hostDevices);
+        capture->AddDevices(switchPorts[0], "switch", true);
+        capture->AddDevices(switchPorts[1], "switch", true);
+        capture->AddDevices(hostDevices, "host", false);
     }
 
     // Run the simulation
@@ -135,6 +486,14 @@ main(int argc, char* argv[])
     FlowMonitorHelper flowmon;
     Ptr<FlowMonitor> monitor = flowmon.InstallAll();
     Simulator::Run();
+    if (capture)
+    {
+        capture->Close();
+        NS_LOG_UNCOND("Captured frames =" << capture->GetCapturedFrames()
+                      << " dropped =" << capture->GetDroppedFrames()
+                      << " sampled out =" << capture->GetSampledOutFrames()
+                      << " bytes =" << capture->GetCapturedBytes());
+    }
         int j=0;
     float AvgThroughput = 0;
     Time Jitter;
@@ -180,6 +539,109 @@ main(int argc, char* argv[])
     NS_LOG_UNCOND("End to End Delay =" << Delay);
     NS_LOG_UNCOND("End to End Jitter delay =" << Jitter);
     NS_LOG_UNCOND("Total Flod id " << j);
+
+    uint64_t packetIns = ctrl0->GetPacketIns() + ctrl1->GetPacketIns();
+    uint64_t learned = ctrl0->GetFlowMods() + ctrl1->GetFlowMods();
+    NS_LOG_UNCOND("--------Control channel (miss_send_len =" << missSendLen << ")----------"
+                  << std::endl);
+    NS_LOG_UNCOND("Bytes to controllers =" << ctrlRxBytes << " from controllers =" << ctrlTxBytes);
+    NS_LOG_UNCOND("Packets to controllers =" << ctrlRxPackets
+                  << " from controllers =" << ctrlTxPackets);
+    NS_LOG_UNCOND("Packet-ins =" << packetIns << " buffered ="
+                  << ctrl0->GetBufferedPacketIns() + ctrl1->GetBufferedPacketIns()
+                  << " data bytes in =" << ctrl0->GetPacketInBytes() + ctrl1->GetPacketInBytes()
+                  << " out =" << ctrl0->GetPacketOutBytes() + ctrl1->GetPacketOutBytes());
+    if (packetIns && learned)
+    {
+        NS_LOG_UNCOND("Control bytes per packet-in =" << (ctrlRxBytes + ctrlTxBytes) / packetIns
+                      << " per new flow entry =" << (ctrlRxBytes + ctrlTxBytes) / learned);
+        NS_LOG_UNCOND("Channel packets from controllers per flow-mod ="
+                      << (double)ctrlTxPackets / learned);
+    }
+    if (ctrlNet)
+    {
+        ctrlNet->Report();
+    }
+    if (flowModBatch > 0)
+    {
+        uint64_t batches = ctrl0->GetBatches() + ctrl1->GetBatches();
+        NS_LOG_UNCOND("Flow-mod batches (barriers) =" << batches << " flow-mods =" << learned
+                      << " per batch =" << (batches ? (double)learned / batches : 0)
+                      << " coalesced =" << ctrl0->GetCoalescedFlowMods() + ctrl1->GetCoalescedFlowMods());
+        NS_LOG_UNCOND("Batch install delay mean ="
+                      << Max(ctrl0->GetMeanBatchDelay(), ctrl1->GetMeanBatchDelay()).GetSeconds() * 1000
+                      << "ms (worst controller) window misses ="
+                      << ctrl0->GetWindowMisses() + ctrl1->GetWindowMisses());
+    }
+    if (faultInjector)
+    {
+        faultInjector->Report();
+        NS_LOG_UNCOND("Controller 0 failovers =" << ctrl0->GetFailovers() << " last at "
+                      << ctrl0->GetLastFailoverTime().GetSeconds() << "s");
+        NS_LOG_UNCOND("Controller 1 failovers =" << ctrl1->GetFailovers() << " last at "
+                      << ctrl1->GetLastFailoverTime().GetSeconds() << "s");
+    }
+    if (tableStats > 0)
+    {
+        NS_LOG_UNCOND("--------Flow tables----------" << std::endl);
+        ctrl0->ReportFlowTables();
+        ctrl1->ReportFlowTables();
+    }
+    if (queues)
+    {
+        queues->WriteSummary("queue-stats.csv");
+        queues->Report();
+    }
+    if (copies)
+    {
+        NS_LOG_UNCOND("--------Datapath copies----------" << std::endl);
+        copies->Report();
+    }
+    if (warm)
+    {
+        NS_LOG_UNCOND("Warm-up setup wall time =" << setupWallMs << "ms"
+                      << " ARP entries =" << arpEntries
+                      << " static flows =" << ctrl0->GetStaticFlowMods() + ctrl1->GetStaticFlowMods()
+                      << " switches ready at "
+                      << Max(ctrl0->GetConfiguredTime(), ctrl1->GetConfiguredTime()).GetSeconds()
+                      << "s");
+    }
+    if (arpProxy)
+    {
+        NS_LOG_UNCOND("ARP broadcasts suppressed ="
+                      << ctrl0->GetArpSuppressed() + ctrl1->GetArpSuppressed()
+                      << " flooded =" << ctrl0->GetArpFlooded() + ctrl1->GetArpFlooded());
+    }
+    if (killMaster > 0)
+    {
+        NS_LOG_UNCOND("Controller 0 killed at " << killMaster << "s");
+        if (ctrl1->GetTakeovers())
+        {
+            NS_LOG_UNCOND("Failure detected after "
+                          << ctrl1->GetDetectionTime().GetSeconds() - killMaster << "s");
+            NS_LOG_UNCOND("Takeover time =" << ctrl1->GetTakeoverTime().GetSeconds() - killMaster
+                          << "s switches =" << ctrl1->GetTakeovers());
+            NS_LOG_UNCOND("Flow-setup backlog =" << ctrl1->GetBacklog()
+                          << " packet-ins in the first second");
+        }
+        else
+        {
+            NS_LOG_UNCOND("No takeover (run with --redundant)");
+        }
+    }
+    if (replayer)
+    {
+        NS_LOG_UNCOND("Replayed packets =" << replayer->GetSent());
+        NS_LOG_UNCOND("Replayed bytes =" << replayer->GetSentBytes());
+        NS_LOG_UNCOND("Replay skipped records =" << replayer->GetSkipped());
+    }
+    if (flows)
+    {
+        NS_LOG_UNCOND("Workload flows =" << flows->GetFlows().size());
+        NS_LOG_UNCOND("Workload bytes =" << flows->GetTotalBytes());
+        fct->Report();
+        fct->WriteFlows("fct.txt");
+    }
     monitor->SerializeToXmlFile("manet-routing.xml", true, true);    
     Simulator::Destroy();
 }
@@ -0,0 +1,1659 @@
+/*
+ * Learning controller for the scenario domains.
+ *
+ * Same L2 learning behaviour as OFSwitch13LearningController (one exact
+ * eth_dst entry per learned MAC, 10 s idle timeout, flooding of unknown
+ * destinations), but with the per-switch port and MAC tables kept in the
+ * open so the scenarios can build on them:
+ *
+ *  - Flooding goes to an explicit list of live ports taken from the port
+ *    description, so a redundant link can be kept as a standby port that
+ *    carries no traffic until its primary fails.
+ *  - Port-status messages drive failover: when a port goes down, its
+ *    entries move to the standby port (or are flushed) and the flows that
+ *    output to it are deleted.
+ *  - Switches may connect to several controllers with OpenFlow roles. A
+ *    slave ignores the switch until its peers stop sending heartbeats (UDP
+ *    packets over the control network), then claims the master role and
+ *    starts learning from scratch.
+ *  - Flow table telemetry: table statistics polled from the switches and
+ *    flow-removed reasons are written as a per-switch time series.
+ *  - Aggregated forwarding: when a whole IPv4 prefix sits behind one port
+ *    (the other domain behind the inter-switch link), a single ip_dst
+ *    prefix entry replaces the per-MAC entries of all hosts behind it.
+ *  - ARP proxy: the controller learns IPv4 to MAC bindings from ARP senders
+ *    and answers the requests it can (looking up its peers too) instead of
+ *    flooding them.
+ *  - Static hosts: known host locations can be installed as permanent
+ *    entries on connection, so a run starts without learning.
+ *  - QoS: a classifier table in front of the forwarding table sends ICMP
+ *    to the high priority port queue and meters all other IPv4 traffic into
+ *    the low priority one.
+ *  - Table misses are buffered in the switch: only the first miss_send_len
+ *    bytes reach the controller, and the packet-out refers to the buffer.
+ *  - Batched installation: learned entries can be held per switch for a
+ *    short window and sent back to back behind one barrier, dropping the
+ *    ones superseded in the meantime.
+ *  - Lazy expiry: learned entries can be installed without an idle timeout
+ *    and aged out by the controller instead, from a min-heap of deadlines
+ *    driving a single timer, so no event runs while nothing is due.
+ *  - Flow cache: the most active destinations are moved to the head of the
+ *    forwarding table, which the datapath scans in priority order, so
+ *    established traffic matches after a few entries.
+ */
+
+#ifndef DOMAIN_CONTROLLER_H
+#define DOMAIN_CONTROLLER_H
+
+#include <ns3/core-module.h>
+#include <ns3/internet-module.h>
+#include <ns3/network-module.h>
+#include <ns3/ofswitch13-module.h>
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <queue>
+#include <set>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * L2 learning controller with standby ports and port-status failover.
+ */
+class DomainController : public OFSwitch13Controller
+{
+  public:
+    /** OpenFlow controller roles. EQUAL sends no role request. */
+    enum Role
+    {
+        EQUAL,
+        MASTER,
+        SLAVE
+    };
+
+    DomainController()
+    {
+    }
+
+    ~DomainController() override
+    {
+    }
+
+    static TypeId GetTypeId()
+    {
+        static TypeId tid = TypeId("ns3::DomainController")
+                                .SetParent<OFSwitch13Controller>()
+                                .AddConstructor<DomainController>();
+        return tid;
+    }
+
+    void DoDispose() override
+    {
+        for (auto& entry : m_switches)
+        {
+            Simulator::Cancel(entry.second.flush);
+        }
+        m_switches.clear();
+        m_roles.clear();
+        m_peers.clear();
+        m_hosts.clear();
+        Simulator::Cancel(m_heartbeat);
+        if (m_beatSocket)
+        {
+            m_beatSocket->Close();
+            m_beatSocket = nullptr;
+        }
+        m_beatPeers.clear();
+        Simulator::Cancel(m_tableStatsEvent);
+        Simulator::Cancel(m_expiryEvent);
+        m_expiryHeap = ExpiryHeap_t();
+        Simulator::Cancel(m_cacheEvent);
+        OFSwitch13Controller::DoDispose();
+    }
+
+    /**
+     * Request a role on a switch once it connects.
+     * \param dpId The switch datapath ID.
+     * \param role The role to request.
+     */
+    void SetRole(uint64_t dpId, Role role)
+    {
+        m_roles[dpId] = role;
+    }
+
+    /**
+     * Share host bindings with another controller: the ARP proxy answers
+     * for the hosts it knows while it is alive.
+     * \param peer The other controller.
+     */
+    void AddPeer(Ptr<DomainController> peer)
+    {
+        m_peers.push_back(peer);
+    }
+
+    /**
+     * Exchange heartbeats with another controller of the same switches.
+     * \param address The peer's address on the control network.
+     */
+    void AddHeartbeatPeer(Ipv4Address address)
+    {
+        m_beatPeers[address] = Time(0);
+    }
+
+    /**
+     * Start sending heartbeats to the heartbeat peers and watching theirs,
+     * as UDP packets on HEARTBEAT_PORT. A peer whose heartbeats stop
+     * arriving for deadMisses periods (lost, delayed or never sent) is
+     * declared dead and its switches are taken over. The controller node
+     * must have its control network address.
+     * \param interval The heartbeat period.
+     * \param deadMisses Missed heartbeats before takeover.
+     */
+    void StartHeartbeat(Time interval, uint32_t deadMisses)
+    {
+        m_beatInterval = interval;
+        m_deadInterval = interval * deadMisses;
+        m_beatSocket = Socket::CreateSocket(GetNode(), UdpSocketFactory::GetTypeId());
+        m_beatSocket->Bind(InetSocketAddress(Ipv4Address::GetAny(), HEARTBEAT_PORT));
+        m_beatSocket->SetRecvCallback(MakeCallback(&DomainController::HandleHeartbeat, this));
+        for (auto& peer : m_beatPeers)
+        {
+            peer.second = Simulator::Now();
+        }
+        Heartbeat();
+    }
+
+    /**
+     * Crash the controller: it stops sending heartbeats and ignores every
+     * message from its switches, as a hung process would.
+     */
+    void Kill()
+    {
+        m_alive = false;
+        Simulator::Cancel(m_heartbeat);
+        for (auto& entry : m_switches)
+        {
+            Simulator::Cancel(entry.second.flush);
+            entry.second.batch.clear();
+        }
+        if (m_beatSocket)
+        {
+            m_beatSocket->SetRecvCallback(MakeNullCallback<void, Ptr<Socket>>());
+        }
+    }
+
+    /** \return the time a dead peer was detected (zero if never). */
+    Time GetDetectionTime() const
+    {
+        return m_takeoverStart;
+    }
+
+    /** \return the time the last master role was granted after a takeover. */
+    Time GetTakeoverTime() const
+    {
+        return m_takeoverDone;
+    }
+
+    /**
+     * Poll the flow tables of the switches we are master of and write one
+     * line per switch and non-empty table: time, datapath ID, table, active
+     * entries, lookups, matches, and the idle and hard timeout expirations
+     * reported by flow-removed messages so far.
+     * \param interval The polling period.
+     * \param filename The output file name.
+     */
+    void StartTableStats(Time interval, std::string filename)
+    {
+        m_tableStatsInterval = interval;
+        m_tableStats.open(filename);
+        m_tableStats << "#time_s dpid table entries lookups matched idle_expired hard_expired\n";
+        m_tableStatsEvent =
+            Simulator::Schedule(interval, &DomainController::PollTableStats, this);
+    }
+
+    /**
+     * Print per-switch peak flow table occupancy and timeout expirations,
+     * and the flow cache hit rate and scan cost when it is on.
+     */
+    void ReportFlowTables() const
+    {
+        for (const auto& entry : m_switches)
+        {
+            const SwitchInfo& sw = entry.second;
+            if (sw.cachePackets)
+            {
+                NS_LOG_UNCOND("Switch " << entry.first << " flow cache hit rate ="
+                                        << 100.0 * sw.cacheHits / sw.cachePackets
+                                        << "% entries scanned per packet ="
+                                        << sw.scanned / sw.cachePackets << " without the cache ="
+                                        << sw.scannedUncached / sw.cachePackets);
+            }
+            if (!sw.polled)
+            {
+                continue;
+            }
+            NS_LOG_UNCOND("Switch " << entry.first << " peak entries =" << sw.peakEntries
+                                    << " idle expired =" << sw.idleExpired
+                                    << " hard expired =" << sw.hardExpired);
+            if (sw.lookups)
+            {
+                // The software datapath scans each table as a priority-sorted
+                // list, so the entries of the tables a packet visits are its
+                // search cost.
+                NS_LOG_UNCOND("Switch " << entry.first << " lookups =" << sw.lookups
+                                        << " entries per lookup =" << sw.lookupEntries / sw.lookups);
+            }
+        }
+    }
+
+    /** \return the number of switches taken over from dead peers. */
+    uint32_t GetTakeovers() const
+    {
+        return m_takeovers;
+    }
+
+    /**
+     * \return the packet-in messages from taken-over switches in the
+     *         first second after the takeover: the flows that had to be
+     *         set up again by the new master.
+     */
+    uint64_t GetBacklog() const
+    {
+        return m_backlog;
+    }
+
+    /**
+     * Keep a redundant port out of forwarding until its primary goes down.
+     * \param dpId The switch datapath ID.
+     * \param primary The port normally in use.
+     * \param backup The port that takes over on failure.
+     */
+    void SetStandbyPort(uint64_t dpId, uint32_t primary, uint32_t backup)
+    {
+        SwitchInfo& sw = m_switches[dpId];
+        sw.standby[primary] = backup;
+        sw.ports[backup].blocked = true;
+    }
+
+    /**
+     * Forward an IPv4 prefix out of one port with a single flow entry.
+     * MACs learned on that port get no per-host entry of their own.
+     * \param dpId The switch datapath ID.
+     * \param prefix The destination network.
+     * \param mask The network mask.
+     * \param port The port the network sits behind.
+     */
+    void AddPrefixRoute(uint64_t dpId, Ipv4Address prefix, Ipv4Mask mask, uint32_t port)
+    {
+        m_switches[dpId].routes.push_back({prefix, mask, port});
+    }
+
+    /**
+     * \param enable Answer ARP requests for known hosts in the controller.
+     */
+    void SetArpProxy(bool enable)
+    {
+        m_arpProxy = enable;
+    }
+
+    /** \return the number of ARP broadcasts answered instead of flooded. */
+    uint64_t GetArpSuppressed() const
+    {
+        return m_arpSuppressed;
+    }
+
+    /** \return the number of ARP requests flooded for unknown targets. */
+    uint64_t GetArpFlooded() const
+    {
+        return m_arpFlooded;
+    }
+
+    /**
+     * Pre-populate a host location. The permanent forwarding entry is
+     * installed with the table-miss entry once the switch connects, and the
+     * binding feeds the ARP proxy.
+     * \param dpId The switch datapath ID.
+     * \param mac The host address.
+     * \param port The port the host sits behind.
+     * \param ip The host IPv4 address.
+     */
+    void AddStaticHost(uint64_t dpId, Mac48Address mac, uint32_t port, Ipv4Address ip)
+    {
+        SwitchInfo& sw = m_switches[dpId];
+        sw.statics[mac] = port;
+        sw.l2[mac] = port;
+        m_hosts[ip] = mac;
+    }
+
+    /**
+     * Classify traffic before forwarding: ICMP goes to queue 0, other IPv4
+     * traffic is policed to the given rate and goes to queue 1. The
+     * forwarding entries move to table 1. Port queues must be strict
+     * priority queues with at least two queues.
+     * \param bulkRate The meter rate for non-latency-sensitive traffic.
+     */
+    void SetQos(DataRate bulkRate)
+    {
+        m_qos = true;
+        m_bulkRate = bulkRate;
+        m_l2Table = 1;
+    }
+
+    /**
+     * \param len Bytes of a table-miss packet sent to the controller, the
+     *            rest staying in the switch buffer until the packet-out.
+     *            OFPCML_NO_BUFFER sends whole packets and buffers nothing.
+     */
+    void SetMissSendLen(uint16_t len)
+    {
+        m_missSendLen = len;
+    }
+
+    /** \return the packet data bytes received in packet-ins. */
+    uint64_t GetPacketInBytes() const
+    {
+        return m_packetInBytes;
+    }
+
+    /** \return the packet-ins that referred to a switch buffer. */
+    uint64_t GetBufferedPacketIns() const
+    {
+        return m_bufferedPacketIns;
+    }
+
+    /** \return the packet data bytes sent back in packet-outs. */
+    uint64_t GetPacketOutBytes() const
+    {
+        return m_packetOutBytes;
+    }
+
+    /**
+     * Hold learned entries per switch and install them together, followed
+     * by a barrier, once the window since the first of them has passed.
+     * \param window The batching window, zero to install at once.
+     */
+    void SetFlowModBatching(Time window)
+    {
+        m_batchWindow = window;
+    }
+
+    /** \return the batches flushed, one barrier request each. */
+    uint64_t GetBatches() const
+    {
+        return m_batches;
+    }
+
+    /** \return the batched entries dropped before the flush. */
+    uint64_t GetCoalescedFlowMods() const
+    {
+        return m_coalesced;
+    }
+
+    /**
+     * \return the packet-ins for destinations whose entry was waiting in a
+     *         batch: the extra controller work the window causes.
+     */
+    uint64_t GetWindowMisses() const
+    {
+        return m_windowMisses;
+    }
+
+    /** \return the mean time batched entries waited for the flush. */
+    Time GetMeanBatchDelay() const
+    {
+        return m_batchedEntries ? NanoSeconds(m_batchDelay.GetNanoSeconds() / m_batchedEntries)
+                               : Time(0);
+    }
+
+    /**
+     * Age learned entries out in the controller instead of the datapath.
+     * Entries are installed without an idle timeout; when one's deadline
+     * comes up, a flow stats request tells whether it matched packets since
+     * the last check. Active entries are given another idle period, the
+     * others are deleted, so an entry lives between one and two idle
+     * timeouts past its last packet.
+     * \param enable True to expire learned entries from the controller.
+     */
+    void SetLazyExpiry(bool enable)
+    {
+        m_lazyExpiry = enable;
+    }
+
+    /** \return the flow stats requests sent to check due entries. */
+    uint64_t GetExpiryChecks() const
+    {
+        return m_expiryChecks;
+    }
+
+    /**
+     * Keep the most active destinations of each switch at the head of its
+     * forwarding table. The datapath scans a table in priority order and
+     * stops at the first match, so these entries are moved to CACHE_PRIO
+     * and the others stay at L2_PRIO. Every interval, flow stats give the
+     * packets each entry matched since the last refresh; the size busiest
+     * ones are placed in the cache and the rest moved back. A flow-mod for
+     * a cached destination replaces its cache entry. The stats also give
+     * the entries the forwarding table scanned per packet, with and
+     * without the cache. Not for use with lazy expiry, whose checks read
+     * the packet counts a move resets.
+     * \param size The cached destinations per switch.
+     * \param interval The refresh period.
+     */
+    void StartFlowCache(uint32_t size, Time interval)
+    {
+        m_cacheSize = size;
+        m_cacheInterval = interval;
+        m_cacheEvent = Simulator::Schedule(interval, &DomainController::PollFlowCache, this);
+    }
+
+    /** \return the entries moved in or out of the flow caches. */
+    uint64_t GetCacheMoves() const
+    {
+        return m_cacheMoves;
+    }
+
+    /** \return the flow-mods sent to install static hosts. */
+    uint64_t GetStaticFlowMods() const
+    {
+        return m_staticFlowMods;
+    }
+
+    /** \return the time the last switch was configured. */
+    Time GetConfiguredTime() const
+    {
+        return m_configured;
+    }
+
+    /**
+     * Keep a port out of forwarding for good, e.g. a link off the spanning
+     * tree of a topology with loops.
+     * \param dpId The switch datapath ID.
+     * \param port The port to block.
+     */
+    void BlockPort(uint64_t dpId, uint32_t port)
+    {
+        m_switches[dpId].ports[port].blocked = true;
+    }
+
+    /** \return the number of packet-in messages handled. */
+    uint64_t GetPacketIns() const
+    {
+        return m_packetIns;
+    }
+
+    /** \return the number of flow-mod messages sent. */
+    uint64_t GetFlowMods() const
+    {
+        return m_flowMods;
+    }
+
+    /** \return the number of port-down events handled. */
+    uint32_t GetFailovers() const
+    {
+        return m_failovers;
+    }
+
+    /** \return the time the last port-down port-status was handled. */
+    Time GetLastFailoverTime() const
+    {
+        return m_lastFailover;
+    }
+
+    /** UDP port of the controller heartbeats. */
+    static constexpr uint16_t HEARTBEAT_PORT = 6655;
+
+    /**
+     * Priority of the exact eth_dst entries, above the prefix routes (1)
+     * and the table-miss entry (0). Exact entries never overlap, so they
+     * all share it and a re-add replaces the previous entry.
+     */
+    static constexpr uint16_t L2_PRIO = 100;
+
+    /** Priority of the exact eth_dst entries placed in the flow cache. */
+    static constexpr uint16_t CACHE_PRIO = 200;
+
+  protected:
+    /** Learned MAC to port table of one switch. */
+    typedef std::map<Mac48Address, uint32_t> L2Table_t;
+
+    /** Controller view of one switch port. */
+    struct PortInfo
+    {
+        bool up{true};        //!< Link and admin state are up
+        bool blocked{false};  //!< Standby port, not used for forwarding
+        bool described{false}; //!< Reported by the port description
+    };
+
+    /** A learned entry waiting in a batch. */
+    struct BatchedEntry
+    {
+        uint32_t port;
+        uint16_t idle;
+        Time learned;
+    };
+
+    /** A learned entry aged by the controller. */
+    struct LazyEntry
+    {
+        uint16_t idle;    //!< Idle timeout in seconds
+        uint64_t packets; //!< Packet count at the last check
+        Time deadline;    //!< Next activity check
+    };
+
+    /** Pending activity checks: deadline, datapath ID and MAC, earliest first. */
+    typedef std::tuple<Time, uint64_t, Mac48Address> ExpiryItem_t;
+    typedef std::priority_queue<ExpiryItem_t, std::vector<ExpiryItem_t>, std::greater<ExpiryItem_t>>
+        ExpiryHeap_t;
+
+    /** Packet count of a forwarding entry at the last cache refresh. */
+    struct CacheCounter
+    {
+        uint16_t priority;
+        uint64_t packets;
+    };
+
+    /** An aggregated IPv4 route. */
+    struct PrefixRoute
+    {
+        Ipv4Address prefix;
+        Ipv4Mask mask;
+        uint32_t port;
+    };
+
+    /** Controller view of one switch. */
+    struct SwitchInfo
+    {
+        L2Table_t l2;                           //!< Learned MAC locations
+        std::map<uint32_t, PortInfo> ports;     //!< Ports by number
+        std::map<uint32_t, uint32_t> standby;   //!< Primary to backup port
+        Ptr<const RemoteSwitch> remote;         //!< Connection to the switch
+        Time takenOver;                         //!< Takeover time, zero if none
+        bool polled{false};                     //!< Table stats received
+        uint32_t peakEntries{0};                //!< Largest total of active entries
+        uint64_t idleExpired{0};                //!< Idle timeout removals
+        uint64_t hardExpired{0};                //!< Hard timeout removals
+        std::map<uint32_t, uint64_t> lastLookups; //!< Lookups per table at the last poll
+        uint64_t lookups{0};                    //!< Pipeline lookups over the polls
+        double lookupEntries{0};                //!< Lookups weighted by table size
+        std::vector<PrefixRoute> routes;        //!< Aggregated routes
+        L2Table_t statics;                      //!< Pre-populated hosts
+        std::map<Mac48Address, BatchedEntry> batch; //!< Entries waiting for the flush
+        EventId flush;                          //!< Batch flush
+        std::map<Mac48Address, LazyEntry> lazy; //!< Entries aged by the controller
+        std::set<Mac48Address> cached;          //!< Destinations in the flow cache
+        std::map<Mac48Address, CacheCounter> counters; //!< Exact entry counts at the last refresh
+        std::map<uint16_t, uint64_t> otherCounters; //!< Route and miss counts per priority
+        uint64_t cachePackets{0};               //!< Packets seen by the refreshes
+        uint64_t cacheHits{0};                  //!< Packets matched by cached entries
+        double scanned{0};                      //!< Entries scanned by those packets
+        double scannedUncached{0};              //!< Same, with every exact entry at L2_PRIO
+    };
+
+    void HandshakeSuccessful(Ptr<const RemoteSwitch> swtch) override
+    {
+        uint64_t dpId = swtch->GetDpId();
+        m_switches[dpId].remote = swtch;
+
+        Role role = GetRole(dpId);
+        if (role != EQUAL)
+        {
+            SendRoleRequest(swtch, role);
+        }
+        if (role != SLAVE)
+        {
+            Configure(dpId);
+        }
+
+        // Ask for the port list, used for flooding.
+        DpctlExecute(dpId, "port-desc");
+    }
+
+    /**
+     * Install the table-miss entry sending packets to the controller, as the
+     * default learning controller does, and the aggregated routes.
+     */
+    void Configure(uint64_t dpId)
+    {
+        if (m_qos)
+        {
+            std::ostringstream meter;
+            meter << "meter-mod cmd=add,flags=1,meter=1 drop:rate="
+                  << m_bulkRate.GetBitRate() / 1000;
+            DpctlExecute(dpId, meter.str());
+            DpctlExecute(dpId, "flow-mod cmd=add,table=0,prio=2 eth_type=0x800,ip_proto=1"
+                               " apply:queue=0 goto:1");
+            DpctlExecute(dpId, "flow-mod cmd=add,table=0,prio=1 eth_type=0x800"
+                               " meter:1 apply:queue=1 goto:1");
+            DpctlExecute(dpId, "flow-mod cmd=add,table=0,prio=0 goto:1");
+        }
+        std::ostringstream miss;
+        miss << "flow-mod cmd=add,table=" << m_l2Table
+             << ",prio=0 apply:output=ctrl:" << m_missSendLen;
+        DpctlExecute(dpId, miss.str());
+        std::ostringstream config;
+        config << "set-config miss=" << m_missSendLen;
+        DpctlExecute(dpId, config.str());
+        const SwitchInfo& sw = m_switches[dpId];
+        for (const auto& route : sw.routes)
+        {
+            InstallRoute(dpId, route);
+        }
+        for (const auto& host : sw.statics)
+        {
+            if (!IsRouted(sw, host.second))
+            {
+                InstallL2Entry(dpId, host.first, host.second, 0);
+                m_staticFlowMods++;
+            }
+        }
+        m_configured = Simulator::Now();
+    }
+
+    /**
+     * Install a prefix entry. It sits just above the table-miss entry, as
+     * the exact eth_dst entries never cover hosts behind a routed port.
+     */
+    void InstallRoute(uint64_t dpId, const PrefixRoute& route)
+    {
+        std::ostringstream cmd;
+        cmd << "flow-mod cmd=add,table=" << m_l2Table
+            << ",prio=1 eth_type=0x800,ip_dst=" << route.prefix << "/"
+            << route.mask.GetPrefixLength() << " apply:output=" << route.port;
+        DpctlExecute(dpId, cmd.str());
+        m_flowMods++;
+    }
+
+    /** \return true if a prefix route covers the hosts behind the port. */
+    static bool IsRouted(const SwitchInfo& sw, uint32_t port)
+    {
+        for (const auto& route : sw.routes)
+        {
+            if (route.port == port)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    ofl_err HandleRoleReply(struct ofl_msg_role_request* msg,
+                            Ptr<const RemoteSwitch> swtch,
+                            uint32_t xid) override
+    {
+        uint64_t dpId = swtch->GetDpId();
+        if (m_alive && msg->role == OFPCR_ROLE_MASTER && GetRole(dpId) == SLAVE)
+        {
+            // Takeover granted: the switch now reports to us.
+            m_roles[dpId] = MASTER;
+            m_switches[dpId].takenOver = Simulator::Now();
+            m_takeoverDone = Simulator::Now();
+            m_takeovers++;
+            Configure(dpId);
+        }
+        ofl_msg_free((struct ofl_msg_header*)msg, nullptr);
+        return 0;
+    }
+
+    ofl_err HandlePacketIn(struct ofl_msg_packet_in* msg,
+                           Ptr<const RemoteSwitch> swtch,
+                           uint32_t xid) override
+    {
+        uint64_t dpId = swtch->GetDpId();
+        if (!m_alive || GetRole(dpId) == SLAVE)
+        {
+            ofl_msg_free((struct ofl_msg_header*)msg, nullptr);
+            return 0;
+        }
+        m_packetIns++;
+        m_packetInBytes += msg->data_length;
+        if (msg->buffer_id != NO_BUFFER)
+        {
+            m_bufferedPacketIns++;
+        }
+        Time takenOver = m_switches[dpId].takenOver;
+        if (!takenOver.IsZero() && Simulator::Now() - takenOver < Seconds(1))
+        {
+            m_backlog++;
+        }
+        if (msg->reason == OFPR_NO_MATCH)
+        {
+            SwitchInfo& sw = m_switches[dpId];
+
+            struct ofl_match_tlv* input =
+                oxm_match_lookup(OXM_OF_IN_PORT, (struct ofl_match*)msg->match);
+            uint32_t inPort;
+            memcpy(&inPort, input->value, OXM_LENGTH(OXM_OF_IN_PORT));
+
+            struct ofl_match_tlv* ethSrc =
+                oxm_match_lookup(OXM_OF_ETH_SRC, (struct ofl_match*)msg->match);
+            Mac48Address src48;
+            src48.CopyFrom(ethSrc->value);
+
+            struct ofl_match_tlv* ethDst =
+                oxm_match_lookup(OXM_OF_ETH_DST, (struct ofl_match*)msg->match);
+            Mac48Address dst48;
+            dst48.CopyFrom(ethDst->value);
+
+            // Packets arriving on a standby port are duplicates; drop them.
+            if (sw.ports[inPort].blocked)
+            {
+                SendPacketOut(swtch, msg, inPort, std::vector<uint32_t>(), xid);
+                ofl_msg_free((struct ofl_msg_header*)msg, nullptr);
+                return 0;
+            }
+
+            std::vector<uint32_t> outPorts;
+            auto itDst = dst48.IsBroadcast() ? sw.l2.end() : sw.l2.find(dst48);
+            if (itDst != sw.l2.end())
+            {
+                outPorts.push_back(itDst->second);
+                if (sw.batch.count(dst48))
+                {
+                    m_windowMisses++;
+                }
+            }
+            else
+            {
+                outPorts = FloodPorts(sw, inPort);
+            }
+
+            // Learn the source location and install its forwarding entry,
+            // unless a prefix route already covers the port. Non-IP packets
+            // to such hosts keep coming here and are sent out directly.
+            if (sw.l2.find(src48) == sw.l2.end())
+            {
+                sw.l2[src48] = inPort;
+                if (!IsRouted(sw, inPort))
+                {
+                    InstallL2Entry(dpId, src48, inPort);
+                }
+            }
+
+            if (m_arpProxy && AnswerArp(swtch, msg, inPort))
+            {
+                // Answered: drop the request instead of flooding it.
+                outPorts.clear();
+            }
+
+            SendPacketOut(swtch, msg, inPort, outPorts, xid);
+        }
+
+        // All handlers must free the message when everything is ok
+        ofl_msg_free((struct ofl_msg_header*)msg, nullptr);
+        return 0;
+    }
+
+    ofl_err HandleFlowRemoved(struct ofl_msg_flow_removed* msg,
+                              Ptr<const RemoteSwitch> swtch,
+                              uint32_t xid) override
+    {
+        uint64_t dpId = swtch->GetDpId();
+        if (msg->reason == OFPRR_IDLE_TIMEOUT)
+        {
+            m_switches[dpId].idleExpired++;
+        }
+        else if (msg->reason == OFPRR_HARD_TIMEOUT)
+        {
+            m_switches[dpId].hardExpired++;
+        }
+
+        // Deletions are ours (failover, expiry checks) and the table was
+        // already updated, possibly with the entry reinstalled elsewhere.
+        struct ofl_match_tlv* ethDst =
+            oxm_match_lookup(OXM_OF_ETH_DST, (struct ofl_match*)msg->stats->match);
+        if (m_alive && ethDst && msg->reason != OFPRR_DELETE)
+        {
+            Mac48Address dst48;
+            dst48.CopyFrom(ethDst->value);
+            m_switches[dpId].l2.erase(dst48);
+            m_switches[dpId].lazy.erase(dst48);
+            m_switches[dpId].cached.erase(dst48);
+        }
+        ofl_msg_free_flow_removed(msg, true, nullptr);
+        return 0;
+    }
+
+    ofl_err HandleMultipartReply(struct ofl_msg_multipart_reply_header* msg,
+                                 Ptr<const RemoteSwitch> swtch,
+                                 uint32_t xid) override
+    {
+        if (msg->type == OFPMP_PORT_DESC)
+        {
+            SwitchInfo& sw = m_switches[swtch->GetDpId()];
+            auto reply = (struct ofl_msg_multipart_reply_port_desc*)msg;
+            for (size_t i = 0; i < reply->stats_num; i++)
+            {
+                struct ofl_port* port = reply->stats[i];
+                PortInfo& info = sw.ports[port->port_no];
+                info.described = true;
+                info.up = IsUp(port);
+            }
+        }
+        else if (msg->type == OFPMP_TABLE)
+        {
+            SwitchInfo& sw = m_switches[swtch->GetDpId()];
+            auto reply = (struct ofl_msg_multipart_reply_table*)msg;
+            uint32_t entries = 0;
+            for (size_t i = 0; i < reply->stats_num; i++)
+            {
+                struct ofl_table_stats* table = reply->stats[i];
+                if (!table->active_count && !table->lookup_count)
+                {
+                    continue;
+                }
+                entries += table->active_count;
+                uint64_t lookups = table->lookup_count - sw.lastLookups[table->table_id];
+                sw.lastLookups[table->table_id] = table->lookup_count;
+                sw.lookupEntries += (double)lookups * table->active_count;
+                if (table->table_id == 0)
+                {
+                    sw.lookups += lookups;
+                }
+                m_tableStats << Simulator::Now().GetSeconds() << " " << swtch->GetDpId() << " "
+                             << (uint32_t)table->table_id << " " << table->active_count << " "
+                             << table->lookup_count << " " << table->matched_count << " "
+                             << sw.idleExpired << " " << sw.hardExpired << "\n";
+            }
+            sw.polled = true;
+            sw.peakEntries = std::max(sw.peakEntries, entries);
+        }
+        else if (msg->type == OFPMP_FLOW && m_cacheSize)
+        {
+            RefreshCache(swtch->GetDpId(), (struct ofl_msg_multipart_reply_flow*)msg);
+        }
+        else if (msg->type == OFPMP_FLOW)
+        {
+            CheckIdle(swtch->GetDpId(), (struct ofl_msg_multipart_reply_flow*)msg);
+        }
+        ofl_msg_free((struct ofl_msg_header*)msg, nullptr);
+        return 0;
+    }
+
+    ofl_err HandlePortStatus(struct ofl_msg_port_status* msg,
+                             Ptr<const RemoteSwitch> swtch,
+                             uint32_t xid) override
+    {
+        uint64_t dpId = swtch->GetDpId();
+        SwitchInfo& sw = m_switches[dpId];
+        uint32_t portNo = msg->desc->port_no;
+        PortInfo& info = sw.ports[portNo];
+        bool up = IsUp(msg->desc) && msg->reason != OFPPR_DELETE;
+        info.described = true;
+        if (info.up && !up)
+        {
+            // Slaves track the port state but leave the failover to the
+            // master.
+            info.up = false;
+            if (m_alive && GetRole(dpId) != SLAVE)
+            {
+                PortDown(dpId, sw, portNo);
+            }
+        }
+        else if (!info.up && up)
+        {
+            // Failover is non-revertive: a recovered port that was demoted
+            // to standby stays blocked until its new primary fails.
+            info.up = true;
+        }
+        ofl_msg_free((struct ofl_msg_header*)msg, nullptr);
+        return 0;
+    }
+
+    /**
+     * Install the forwarding entry for a learned MAC. Entries expire after
+     * idle seconds and notify the controller (flags=0x0001). With batching
+     * on, the entry waits for the switch's next flush.
+     * \param dpId The switch datapath ID.
+     * \param mac The learned address.
+     * \param port The port it was learned on.
+     * \param idle The idle timeout in seconds, 0 for a permanent entry.
+     */
+    void InstallL2Entry(uint64_t dpId, Mac48Address mac, uint32_t port, uint16_t idle = 10)
+    {
+        if (!m_batchWindow.IsZero())
+        {
+            SwitchInfo& sw = m_switches[dpId];
+            if (sw.batch.empty())
+            {
+                sw.flush =
+                    Simulator::Schedule(m_batchWindow, &DomainController::FlushBatch, this, dpId);
+            }
+            else if (sw.batch.count(mac))
+            {
+                m_coalesced++;
+            }
+            sw.batch[mac] = {port, idle, Simulator::Now()};
+            return;
+        }
+        SendL2Entry(dpId, mac, port, idle);
+    }
+
+    /**
+     * Send the entries of a batch that still match the learned table, then
+     * a barrier so the switch confirms them all at once.
+     */
+    void FlushBatch(uint64_t dpId)
+    {
+        SwitchInfo& sw = m_switches[dpId];
+        if (!m_alive || !sw.remote || GetRole(dpId) == SLAVE)
+        {
+            // Killed or demoted while the batch waited: the switch is no
+            // longer ours to program.
+            sw.batch.clear();
+            return;
+        }
+        for (const auto& entry : sw.batch)
+        {
+            auto it = sw.l2.find(entry.first);
+            if (it == sw.l2.end() || it->second != entry.second.port)
+            {
+                m_coalesced++;
+                continue;
+            }
+            SendL2Entry(dpId, entry.first, entry.second.port, entry.second.idle);
+            m_batchDelay += Simulator::Now() - entry.second.learned;
+            m_batchedEntries++;
+        }
+        sw.batch.clear();
+        struct ofl_msg_header barrier;
+        barrier.type = OFPT_BARRIER_REQUEST;
+        SendToSwitch(sw.remote, &barrier);
+        m_batches++;
+    }
+
+    /**
+     * Send the flow-mod of a learned entry. With lazy expiry on, the entry
+     * is permanent in the switch and its first check goes on the heap.
+     */
+    void SendL2Entry(uint64_t dpId, Mac48Address mac, uint32_t port, uint16_t idle)
+    {
+        if (m_switches[dpId].cached.erase(mac))
+        {
+            // Invalidate the cached copy, it would shadow the new entry.
+            std::ostringstream del;
+            del << "flow-mod cmd=dels,table=" << m_l2Table << ",prio=" << CACHE_PRIO
+                << " eth_dst=" << mac;
+            DpctlExecute(dpId, del.str());
+            m_flowMods++;
+        }
+        std::ostringstream cmd;
+        cmd << "flow-mod cmd=add,table=" << m_l2Table;
+        if (idle && m_lazyExpiry)
+        {
+            Time deadline = Simulator::Now() + Seconds(idle);
+            m_switches[dpId].lazy[mac] = {idle, 0, deadline};
+            m_expiryHeap.emplace(deadline, dpId, mac);
+            ArmExpiry();
+        }
+        else if (idle)
+        {
+            cmd << ",idle=" << idle << ",flags=0x0001";
+        }
+        cmd << ",prio=" << L2_PRIO << " eth_dst=" << mac << " apply:output=" << port;
+        DpctlExecute(dpId, cmd.str());
+        m_flowMods++;
+    }
+
+    /**
+     * \param sw The switch.
+     * \param inPort The ingress port, excluded from the list.
+     * \return the live, non-standby ports, or OFPP_FLOOD before the port
+     *         description arrived.
+     */
+    std::vector<uint32_t> FloodPorts(const SwitchInfo& sw, uint32_t inPort) const
+    {
+        std::vector<uint32_t> ports;
+        bool described = false;
+        for (const auto& entry : sw.ports)
+        {
+            described |= entry.second.described;
+            if (entry.first != inPort && entry.second.described && entry.second.up &&
+                !entry.second.blocked)
+            {
+                ports.push_back(entry.first);
+            }
+        }
+        if (!described)
+        {
+            ports.push_back(OFPP_FLOOD);
+        }
+        return ports;
+    }
+
+    /**
+     * Send a packet-out for the packet-in message, reusing its buffer when
+     * the switch buffered the packet. An empty port list drops the packet.
+     */
+    void SendPacketOut(Ptr<const RemoteSwitch> swtch,
+                       struct ofl_msg_packet_in* msg,
+                       uint32_t inPort,
+                       const std::vector<uint32_t>& outPorts,
+                       uint32_t xid)
+    {
+        std::vector<struct ofl_action_output> outputs(outPorts.size());
+        std::vector<struct ofl_action_header*> actions(outPorts.size());
+        for (size_t i = 0; i < outPorts.size(); i++)
+        {
+            outputs[i].header.type = OFPAT_OUTPUT;
+            outputs[i].port = outPorts[i];
+            outputs[i].max_len = 0;
+            actions[i] = (struct ofl_action_header*)&outputs[i];
+        }
+
+        struct ofl_msg_packet_out reply;
+        reply.header.type = OFPT_PACKET_OUT;
+        reply.buffer_id = msg->buffer_id;
+        reply.in_port = inPort;
+        reply.actions_num = actions.size();
+        reply.actions = actions.data();
+        reply.data_length = 0;
+        reply.data = nullptr;
+        if (msg->buffer_id == NO_BUFFER)
+        {
+            // No packet buffer. Send data back to switch
+            reply.data_length = msg->data_length;
+            reply.data = msg->data;
+            m_packetOutBytes += msg->data_length;
+        }
+        SendToSwitch(swtch, (struct ofl_msg_header*)&reply, xid);
+    }
+
+    /** \return true if the port is administratively and physically up. */
+    static bool IsUp(const struct ofl_port* port)
+    {
+        return !(port->config & OFPPC_PORT_DOWN) && !(port->state & OFPPS_LINK_DOWN);
+    }
+
+    /**
+     * Fail over from a port that went down: activate its standby port (if
+     * any), move the learned MACs there and delete the flows using the port.
+     */
+    void PortDown(uint64_t dpId, SwitchInfo& sw, uint32_t portNo)
+    {
+        m_failovers++;
+        m_lastFailover = Simulator::Now();
+
+        std::ostringstream del;
+        del << "flow-mod cmd=del,table=" << m_l2Table << ",out_port=" << portNo;
+        DpctlExecute(dpId, del.str());
+        m_flowMods++;
+
+        uint32_t backup = 0;
+        auto it = sw.standby.find(portNo);
+        if (it != sw.standby.end() && sw.ports[it->second].up)
+        {
+            backup = it->second;
+            sw.ports[backup].blocked = false;
+
+            // Non-revertive: the failed port becomes the standby of its backup.
+            sw.standby.erase(it);
+            sw.standby[backup] = portNo;
+            sw.ports[portNo].blocked = true;
+        }
+
+        for (auto& route : sw.routes)
+        {
+            if (route.port == portNo && backup)
+            {
+                route.port = backup;
+                InstallRoute(dpId, route);
+            }
+        }
+
+        for (auto l2 = sw.l2.begin(); l2 != sw.l2.end();)
+        {
+            if (l2->second != portNo)
+            {
+                ++l2;
+                continue;
+            }
+            // The flow is gone from the switch: stop aging it, the
+            // reinstalled one is armed again.
+            sw.lazy.erase(l2->first);
+            sw.cached.erase(l2->first);
+            if (backup)
+            {
+                l2->second = backup;
+                if (!IsRouted(sw, backup))
+                {
+                    InstallL2Entry(dpId, l2->first, backup);
+                }
+                ++l2;
+            }
+            else
+            {
+                l2 = sw.l2.erase(l2);
+            }
+        }
+    }
+
+    /**
+     * Learn the sender binding of an ARP packet and, for a request whose
+     * target is known here or at a peer, send the reply out of the
+     * ingress port.
+     * \return true if the request was answered.
+     */
+    bool AnswerArp(Ptr<const RemoteSwitch> swtch, struct ofl_msg_packet_in* msg, uint32_t inPort)
+    {
+        // A short miss_send_len may have cut the headers: flood instead.
+        // Ethernet plus an IPv4-over-Ethernet ARP header.
+        if (msg->data_length < 14 + 28)
+        {
+            return false;
+        }
+        Ptr<Packet> packet = Create<Packet>(msg->data, msg->data_length);
+        EthernetHeader eth;
+        packet->RemoveHeader(eth);
+        if (eth.GetLengthType() != ArpL3Protocol::PROT_NUMBER)
+        {
+            return false;
+        }
+        ArpHeader arp;
+        packet->RemoveHeader(arp);
+        Mac48Address senderMac = Mac48Address::ConvertFrom(arp.GetSourceHardwareAddress());
+        m_hosts[arp.GetSourceIpv4Address()] = senderMac;
+        if (!arp.IsRequest())
+        {
+            return false;
+        }
+
+        Mac48Address targetMac;
+        if (!LookupHost(arp.GetDestinationIpv4Address(), targetMac))
+        {
+            m_arpFlooded++;
+            return false;
+        }
+
+        ArpHeader answer;
+        answer.SetReply(targetMac,
+                        arp.GetDestinationIpv4Address(),
+                        senderMac,
+                        arp.GetSourceIpv4Address());
+        EthernetHeader answerEth(false);
+        answerEth.SetSource(targetMac);
+        answerEth.SetDestination(senderMac);
+        answerEth.SetLengthType(ArpL3Protocol::PROT_NUMBER);
+        Ptr<Packet> reply = Create<Packet>();
+        reply->AddHeader(answer);
+        reply->AddHeader(answerEth);
+        std::vector<uint8_t> data(reply->GetSize());
+        reply->CopyData(data.data(), data.size());
+
+        struct ofl_action_output output;
+        output.header.type = OFPAT_OUTPUT;
+        output.port = inPort;
+        output.max_len = 0;
+        struct ofl_action_header* action = (struct ofl_action_header*)&output;
+
+        struct ofl_msg_packet_out out;
+        out.header.type = OFPT_PACKET_OUT;
+        out.buffer_id = NO_BUFFER;
+        out.in_port = OFPP_CONTROLLER;
+        out.actions_num = 1;
+        out.actions = &action;
+        out.data_length = data.size();
+        out.data = data.data();
+        SendToSwitch(swtch, (struct ofl_msg_header*)&out);
+        m_arpSuppressed++;
+        return true;
+    }
+
+    /** Find the MAC of an IPv4 host in our table or a live peer's. */
+    bool LookupHost(Ipv4Address ip, Mac48Address& mac) const
+    {
+        auto it = m_hosts.find(ip);
+        if (it != m_hosts.end())
+        {
+            mac = it->second;
+            return true;
+        }
+        for (const auto& peer : m_peers)
+        {
+            it = peer->m_hosts.find(ip);
+            if (peer->m_alive && it != peer->m_hosts.end())
+            {
+                mac = it->second;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /** \return the role configured (or won) on a switch. */
+    Role GetRole(uint64_t dpId) const
+    {
+        auto it = m_roles.find(dpId);
+        return it == m_roles.end() ? EQUAL : it->second;
+    }
+
+    /**
+     * Send a role request. The generation ID is the current time, so a
+     * later request from any controller always supersedes earlier ones.
+     */
+    void SendRoleRequest(Ptr<const RemoteSwitch> swtch, Role role)
+    {
+        struct ofl_msg_role_request msg;
+        msg.header.type = OFPT_ROLE_REQUEST;
+        msg.role = (role == MASTER) ? OFPCR_ROLE_MASTER : OFPCR_ROLE_SLAVE;
+        msg.generation_id = Simulator::Now().GetNanoSeconds();
+        SendToSwitch(swtch, (struct ofl_msg_header*)&msg);
+    }
+
+    /** Send a heartbeat and check that the peers still send theirs. */
+    void Heartbeat()
+    {
+        for (const auto& peer : m_beatPeers)
+        {
+            m_beatSocket->SendTo(Create<Packet>(8), 0, InetSocketAddress(peer.first, HEARTBEAT_PORT));
+        }
+        for (const auto& peer : m_beatPeers)
+        {
+            if (Simulator::Now() - peer.second >= m_deadInterval)
+            {
+                TakeOver();
+                break;
+            }
+        }
+        m_heartbeat = Simulator::Schedule(m_beatInterval, &DomainController::Heartbeat, this);
+    }
+
+    /** Note the arrival time of the peers' heartbeats. */
+    void HandleHeartbeat(Ptr<Socket> socket)
+    {
+        Ptr<Packet> packet;
+        Address from;
+        while ((packet = socket->RecvFrom(from)))
+        {
+            auto it = m_beatPeers.find(InetSocketAddress::ConvertFrom(from).GetIpv4());
+            if (it != m_beatPeers.end())
+            {
+                it->second = Simulator::Now();
+            }
+        }
+    }
+
+    /** Request table statistics from the switches we manage. */
+    void PollTableStats()
+    {
+        if (!m_alive)
+        {
+            return;
+        }
+        for (const auto& entry : m_switches)
+        {
+            if (entry.second.remote && GetRole(entry.first) != SLAVE)
+            {
+                DpctlExecute(entry.first, "stats-table");
+            }
+        }
+        m_tableStatsEvent =
+            Simulator::Schedule(m_tableStatsInterval, &DomainController::PollTableStats, this);
+    }
+
+    /** Request the forwarding table flow stats of the switches we manage. */
+    void PollFlowCache()
+    {
+        if (!m_alive)
+        {
+            return;
+        }
+        for (const auto& entry : m_switches)
+        {
+            if (entry.second.remote && GetRole(entry.first) != SLAVE)
+            {
+                std::ostringstream cmd;
+                cmd << "stats-flow table=" << m_l2Table;
+                DpctlExecute(entry.first, cmd.str());
+            }
+        }
+        m_cacheEvent = Simulator::Schedule(m_cacheInterval, &DomainController::PollFlowCache, this);
+    }
+
+    /**
+     * Account the packets each forwarding entry matched since the last
+     * refresh, then move the busiest destinations into the cache and the
+     * others out. The datapath keeps entries of equal priority in
+     * insertion order, unknown here, so an entry is taken to sit in the
+     * middle of its priority level.
+     */
+    void RefreshCache(uint64_t dpId, struct ofl_msg_multipart_reply_flow* reply)
+    {
+        /** An exact entry of the reply. */
+        struct Sample
+        {
+            Mac48Address mac;
+            uint16_t priority;
+            uint16_t idle;
+            uint64_t packets;
+        };
+
+        SwitchInfo& sw = m_switches[dpId];
+        std::map<uint16_t, uint32_t, std::greater<uint16_t>> levels;
+        std::map<uint16_t, uint64_t> other;
+        std::vector<Sample> samples;
+        std::map<Mac48Address, CacheCounter> counters;
+        for (size_t i = 0; i < reply->stats_num; i++)
+        {
+            struct ofl_flow_stats* stats = reply->stats[i];
+            if (stats->table_id != m_l2Table)
+            {
+                continue;
+            }
+            levels[stats->priority]++;
+            struct ofl_match_tlv* ethDst =
+                oxm_match_lookup(OXM_OF_ETH_DST, (struct ofl_match*)stats->match);
+            if (!ethDst)
+            {
+                other[stats->priority] += stats->packet_count;
+                continue;
+            }
+            Mac48Address dst48;
+            dst48.CopyFrom(ethDst->value);
+            uint64_t packets = stats->packet_count;
+            auto it = sw.counters.find(dst48);
+            if (it != sw.counters.end() && it->second.priority == stats->priority &&
+                it->second.packets <= packets)
+            {
+                packets -= it->second.packets;
+            }
+            counters[dst48] = {stats->priority, stats->packet_count};
+            samples.push_back({dst48, stats->priority, stats->idle_timeout, packets});
+        }
+        sw.counters.swap(counters);
+
+        // Mean position of an entry in the scan, by priority level.
+        std::map<uint16_t, uint32_t, std::greater<uint16_t>> uncached = levels;
+        uncached[L2_PRIO] += uncached[CACHE_PRIO];
+        uncached.erase(CACHE_PRIO);
+        auto position = [](const std::map<uint16_t, uint32_t, std::greater<uint16_t>>& order,
+                           uint16_t priority) {
+            uint32_t above = 0;
+            for (const auto& level : order)
+            {
+                if (level.first == priority)
+                {
+                    return above + (level.second + 1) / 2.0;
+                }
+                above += level.second;
+            }
+            return (double)above;
+        };
+        for (const auto& sample : samples)
+        {
+            uint16_t flat = sample.priority == CACHE_PRIO ? L2_PRIO : sample.priority;
+            sw.cachePackets += sample.packets;
+            sw.cacheHits += sample.priority == CACHE_PRIO ? sample.packets : 0;
+            sw.scanned += sample.packets * position(levels, sample.priority);
+            sw.scannedUncached += sample.packets * position(uncached, flat);
+        }
+        for (const auto& level : other)
+        {
+            uint64_t packets = level.second;
+            auto it = sw.otherCounters.find(level.first);
+            if (it != sw.otherCounters.end() && it->second <= packets)
+            {
+                packets -= it->second;
+            }
+            sw.cachePackets += packets;
+            sw.scanned += packets * position(levels, level.first);
+            sw.scannedUncached += packets * position(uncached, level.first);
+        }
+        sw.otherCounters.swap(other);
+
+        if (!m_alive || !sw.remote || GetRole(dpId) == SLAVE)
+        {
+            return;
+        }
+        // Busiest first, cached ones first among equals to avoid churn.
+        std::sort(samples.begin(), samples.end(), [](const Sample& a, const Sample& b) {
+            if (a.packets != b.packets)
+            {
+                return a.packets > b.packets;
+            }
+            return a.priority > b.priority;
+        });
+        sw.cached.clear();
+        uint32_t placed = 0;
+        for (const auto& sample : samples)
+        {
+            auto l2 = sw.l2.find(sample.mac);
+            if (l2 == sw.l2.end())
+            {
+                // Not ours to move, but a later flow-mod must still
+                // invalidate it.
+                if (sample.priority == CACHE_PRIO)
+                {
+                    sw.cached.insert(sample.mac);
+                }
+                continue;
+            }
+            bool cache = sample.packets && placed < m_cacheSize;
+            if (cache != (sample.priority == CACHE_PRIO))
+            {
+                MoveEntry(dpId, sample.mac, l2->second, sample.idle, cache);
+            }
+            if (cache)
+            {
+                sw.cached.insert(sample.mac);
+                placed++;
+            }
+        }
+    }
+
+    /**
+     * Move an exact entry in or out of the cache: add it at the new
+     * priority, then strictly delete the old one (reported as OFPRR_DELETE,
+     * which leaves the learned table alone).
+     */
+    void MoveEntry(uint64_t dpId, Mac48Address mac, uint32_t port, uint16_t idle, bool cache)
+    {
+        std::ostringstream add;
+        add << "flow-mod cmd=add,table=" << m_l2Table;
+        if (idle)
+        {
+            add << ",idle=" << idle << ",flags=0x0001";
+        }
+        add << ",prio=" << (cache ? CACHE_PRIO : L2_PRIO) << " eth_dst=" << mac
+            << " apply:output=" << port;
+        DpctlExecute(dpId, add.str());
+        std::ostringstream del;
+        del << "flow-mod cmd=dels,table=" << m_l2Table << ",prio=" << (cache ? L2_PRIO : CACHE_PRIO)
+            << " eth_dst=" << mac;
+        DpctlExecute(dpId, del.str());
+        m_flowMods += 2;
+        m_cacheMoves++;
+    }
+
+    /** Schedule the expiry timer for the earliest deadline, if any. */
+    void ArmExpiry()
+    {
+        if (m_expiryHeap.empty())
+        {
+            return;
+        }
+        Time next = std::get<0>(m_expiryHeap.top());
+        if (!m_expiryEvent.IsExpired() && m_expiryAt <= next)
+        {
+            return;
+        }
+        Simulator::Cancel(m_expiryEvent);
+        m_expiryAt = next;
+        m_expiryEvent =
+            Simulator::Schedule(next - Simulator::Now(), &DomainController::ExpireDue, this);
+    }
+
+    /**
+     * Pop the due deadlines and send one flow stats request per switch that
+     * has entries to check. Heap items left behind by a later deadline of
+     * the same entry are stale and skipped.
+     */
+    void ExpireDue()
+    {
+        std::set<uint64_t> due;
+        while (!m_expiryHeap.empty() && std::get<0>(m_expiryHeap.top()) <= Simulator::Now())
+        {
+            Time deadline;
+            uint64_t dpId;
+            Mac48Address mac;
+            std::tie(deadline, dpId, mac) = m_expiryHeap.top();
+            m_expiryHeap.pop();
+            const SwitchInfo& sw = m_switches[dpId];
+            auto it = sw.lazy.find(mac);
+            if (it != sw.lazy.end() && it->second.deadline == deadline)
+            {
+                due.insert(dpId);
+            }
+        }
+        for (uint64_t dpId : due)
+        {
+            if (m_alive && m_switches[dpId].remote && GetRole(dpId) != SLAVE)
+            {
+                std::ostringstream cmd;
+                cmd << "stats-flow table=" << m_l2Table;
+                DpctlExecute(dpId, cmd.str());
+                m_expiryChecks++;
+            }
+        }
+        ArmExpiry();
+    }
+
+    /**
+     * Check the due entries of a switch against its flow stats: re-arm the
+     * ones that matched packets since the last check, delete the others.
+     * Due entries missing from a complete reply were removed from the
+     * switch some other way and are forgotten.
+     */
+    void CheckIdle(uint64_t dpId, struct ofl_msg_multipart_reply_flow* reply)
+    {
+        SwitchInfo& sw = m_switches[dpId];
+        std::set<Mac48Address> seen;
+        for (size_t i = 0; i < reply->stats_num; i++)
+        {
+            struct ofl_flow_stats* stats = reply->stats[i];
+            struct ofl_match_tlv* ethDst =
+                oxm_match_lookup(OXM_OF_ETH_DST, (struct ofl_match*)stats->match);
+            if (stats->table_id != m_l2Table || !ethDst)
+            {
+                continue;
+            }
+            Mac48Address dst48;
+            dst48.CopyFrom(ethDst->value);
+            seen.insert(dst48);
+            auto it = sw.lazy.find(dst48);
+            if (it == sw.lazy.end() || it->second.deadline > Simulator::Now())
+            {
+                continue;
+            }
+            if (stats->packet_count != it->second.packets)
+            {
+                it->second.packets = stats->packet_count;
+                it->second.deadline = Simulator::Now() + Seconds(it->second.idle);
+                m_expiryHeap.emplace(it->second.deadline, dpId, dst48);
+                continue;
+            }
+            std::ostringstream del;
+            del << "flow-mod cmd=del,table=" << m_l2Table << " eth_dst=" << dst48;
+            DpctlExecute(dpId, del.str());
+            m_flowMods++;
+            sw.idleExpired++;
+            sw.l2.erase(dst48);
+            sw.lazy.erase(it);
+        }
+        if (!(reply->header.flags & OFPMPF_REPLY_MORE))
+        {
+            for (auto it = sw.lazy.begin(); it != sw.lazy.end();)
+            {
+                if (it->second.deadline <= Simulator::Now() && !seen.count(it->first))
+                {
+                    sw.l2.erase(it->first);
+                    it = sw.lazy.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+        }
+        ArmExpiry();
+    }
+
+    /** Claim the master role on every switch we are slave of. */
+    void TakeOver()
+    {
+        for (auto& entry : m_switches)
+        {
+            if (GetRole(entry.first) == SLAVE && entry.second.remote &&
+                entry.second.takenOver.IsZero())
+            {
+                if (m_takeoverStart.IsZero())
+                {
+                    m_takeoverStart = Simulator::Now();
+                }
+                entry.second.takenOver = Simulator::Now();
+                SendRoleRequest(entry.second.remote, MASTER);
+            }
+        }
+    }
+
+    std::map<uint64_t, SwitchInfo> m_switches; //!< Per-switch state
+    std::map<uint64_t, Role> m_roles;          //!< Requested role per switch
+    std::vector<Ptr<DomainController>> m_peers; //!< Controllers to watch
+    std::map<Ipv4Address, Mac48Address> m_hosts; //!< Bindings seen in ARP
+    bool m_arpProxy{false};
+    uint64_t m_staticFlowMods{0};
+    bool m_qos{false};
+    DataRate m_bulkRate;
+    uint32_t m_l2Table{0}; //!< Table holding the forwarding entries
+    uint16_t m_missSendLen{128};
+    uint64_t m_packetInBytes{0};
+    uint64_t m_bufferedPacketIns{0};
+    uint64_t m_packetOutBytes{0};
+    Time m_batchWindow;
+    uint64_t m_batches{0};
+    uint64_t m_coalesced{0};
+    uint64_t m_windowMisses{0};
+    uint64_t m_batchedEntries{0};
+    Time m_batchDelay;
+    bool m_lazyExpiry{false};
+    ExpiryHeap_t m_expiryHeap;
+    EventId m_expiryEvent;
+    Time m_expiryAt;
+    uint64_t m_expiryChecks{0};
+    uint32_t m_cacheSize{0};
+    Time m_cacheInterval;
+    EventId m_cacheEvent;
+    uint64_t m_cacheMoves{0};
+    Time m_configured;
+    uint64_t m_arpSuppressed{0};
+    uint64_t m_arpFlooded{0};
+    bool m_alive{true};
+    Time m_beatInterval;
+    Time m_deadInterval;
+    std::map<Ipv4Address, Time> m_beatPeers; //!< Last heartbeat from each peer
+    Ptr<Socket> m_beatSocket;
+    EventId m_heartbeat;
+    Time m_takeoverStart;
+    Time m_takeoverDone;
+    uint32_t m_takeovers{0};
+    uint64_t m_backlog{0};
+    Time m_tableStatsInterval;
+    EventId m_tableStatsEvent;
+    std::ofstream m_tableStats;
+    uint64_t m_packetIns{0};
+    uint64_t m_flowMods{0};
+    uint32_t m_failovers{0};
+    Time m_lastFailover;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(DomainController);
+
+} // namespace ns3
+
+#endif /* DOMAIN_CONTROLLER_H */
@@ -0,0 +1,274 @@
+/*
+ * Link and switch port fault injection.
+ *
+ * Faults are given as a comma-separated schedule of <target>:<down|up>@<s>
+ * items, for instance "link0:down@3,link0:up@6,s1p2:down@4". Targets are
+ * switch ports (s<switch>p<port>, OpenFlow port numbers) or named links
+ * registered with AddLink ().
+ *
+ * A fault detaches the port's CsmaNetDevice from its channel, which drops
+ * everything sent over it. CsmaNetDevice has no carrier-loss signal that the
+ * OFSwitch13 datapath could observe, so after a configurable detection
+ * delay the injector marks the port down on the switch with a port-mod; the
+ * switch then reports the change to its controllers with a port-status
+ * message, as it would on loss of signal.
+ *
+ * An optional probe flow (Tx and Rx traces of a sender and a receiver)
+ * yields the data-plane convergence time of each fault and the packets
+ * lost during each outage.
+ */
+
+#ifndef FAULT_INJECTOR_H
+#define FAULT_INJECTOR_H
+
+#include <ns3/applications-module.h>
+#include <ns3/core-module.h>
+#include <ns3/csma-module.h>
+#include <ns3/network-module.h>
+#include <ns3/ofswitch13-module.h>
+
+#include <algorithm>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Schedules port and link faults and measures the outages they cause.
+ */
+class FaultInjector : public SimpleRefCount<FaultInjector>
+{
+  public:
+    FaultInjector()
+        : m_detectionDelay(MilliSeconds(1))
+    {
+    }
+
+    /**
+     * \param delay Time between a fault and the switch noticing it.
+     */
+    void SetDetectionDelay(Time delay)
+    {
+        m_detectionDelay = delay;
+    }
+
+    /**
+     * Register all ports of a switch as targets s<index>p<port>.
+     * \param index The switch index used in target names.
+     * \param device The OpenFlow switch device.
+     * \param ports The switch ports, in the order given to InstallSwitch.
+     * \param controller Controller used to deliver the port-mod.
+     */
+    void AddSwitch(uint32_t index,
+                   Ptr<OFSwitch13Device> device,
+                   NetDeviceContainer ports,
+                   Ptr<OFSwitch13Controller> controller)
+    {
+        for (uint32_t i = 0; i < ports.GetN(); i++)
+        {
+            std::ostringstream name;
+            name << "s" << index << "p" << i + 1;
+            m_ports[name.str()] = {DynamicCast<CsmaNetDevice>(ports.Get(i)),
+                                   controller,
+                                   device->GetDatapathId(),
+                                   i + 1};
+        }
+    }
+
+    /**
+     * Name a link by its two switch port targets.
+     * \param name The link target name.
+     * \param portA The first end, as s<switch>p<port>.
+     * \param portB The second end.
+     */
+    void AddLink(std::string name, std::string portA, std::string portB)
+    {
+        NS_ABORT_MSG_IF(!m_ports.count(portA) || !m_ports.count(portB),
+                        "Unknown port in link " << name);
+        m_links[name] = {portA, portB};
+    }
+
+    /**
+     * Parse and schedule a fault schedule.
+     * \param spec Comma-separated <target>:<down|up>@<seconds> items.
+     */
+    void Schedule(std::string spec)
+    {
+        std::istringstream items(spec);
+        std::string item;
+        while (std::getline(items, item, ','))
+        {
+            size_t colon = item.find(':');
+            size_t at = item.find('@');
+            NS_ABORT_MSG_IF(colon == std::string::npos || at == std::string::npos || at < colon,
+                            "Bad fault item " << item);
+            std::string target = item.substr(0, colon);
+            std::string action = item.substr(colon + 1, at - colon - 1);
+            Time when = Seconds(std::stod(item.substr(at + 1)));
+            NS_ABORT_MSG_IF(action != "down" && action != "up", "Bad fault action " << action);
+            NS_ABORT_MSG_IF(!m_ports.count(target) && !m_links.count(target),
+                            "Unknown fault target " << target);
+            Simulator::Schedule(when, &FaultInjector::Apply, this, target, action == "up");
+        }
+    }
+
+    /**
+     * Count the probe packets sent by an application with a
+     * Ptr<const Packet> "Tx" trace (OnOff, UdpClient, ...).
+     */
+    void WatchTx(Ptr<Application> sender)
+    {
+        sender->TraceConnectWithoutContext("Tx", MakeBoundCallback(&FaultInjector::ProbeTx, this));
+    }
+
+    /**
+     * Count the probe packets received by a PacketSink.
+     */
+    void WatchRx(Ptr<PacketSink> receiver)
+    {
+        receiver->TraceConnectWithoutContext("Rx",
+                                             MakeBoundCallback(&FaultInjector::ProbeRx, this));
+    }
+
+    /**
+     * Print, for each down event, the data-plane convergence time (fault
+     * to end of the longest probe gap that follows it) and the probe
+     * packets lost in that window, then the probe totals of the run.
+     * Window losses are the probes sent in it minus those received in it;
+     * for a constant-rate probe the packets in flight at either end cancel
+     * out. An outage that never recovered counts up to the end of the run.
+     */
+    void Report() const
+    {
+        NS_LOG_UNCOND("--------Fault injection----------" << std::endl);
+        for (const auto& outage : m_outages)
+        {
+            Time end = outage.recovered ? outage.gapEnd : Simulator::Now();
+            uint64_t sent = CountIn(m_probeTxTimes, outage.start, end);
+            uint64_t received = CountIn(m_probeRxTimes, outage.start, end);
+            NS_LOG_UNCOND("Fault " << outage.target << " at " << outage.start.GetSeconds() << "s"
+                                   << " convergence ="
+                                   << (outage.recovered ? (outage.gapEnd - outage.start).GetSeconds()
+                                                        : -1)
+                                   << "s lost =" << (sent > received ? sent - received : 0));
+        }
+        if (!m_probeTxTimes.empty())
+        {
+            NS_LOG_UNCOND("Probe sent =" << m_probeTxTimes.size()
+                                         << " received =" << m_probeRxTimes.size()
+                                         << " (whole run, including warm-up and in flight at stop)");
+        }
+    }
+
+  private:
+    /** A registered switch port. */
+    struct Port
+    {
+        Ptr<CsmaNetDevice> device;
+        Ptr<OFSwitch13Controller> controller;
+        uint64_t dpId;
+        uint32_t portNo;
+    };
+
+    /** One down event and the probe gap that followed it. */
+    struct Outage
+    {
+        std::string target;
+        Time start;
+        Time gapEnd;
+        Time maxGap;
+        bool recovered;
+    };
+
+    void Apply(std::string target, bool up)
+    {
+        if (!up)
+        {
+            m_outages.push_back({target, Simulator::Now(), Time(0), Time(0), false});
+        }
+        auto link = m_links.find(target);
+        if (link != m_links.end())
+        {
+            SetPort(m_ports[link->second.first], up);
+            SetPort(m_ports[link->second.second], up);
+        }
+        else
+        {
+            SetPort(m_ports[target], up);
+        }
+    }
+
+    void SetPort(Port& port, bool up)
+    {
+        Ptr<CsmaChannel> channel = DynamicCast<CsmaChannel>(port.device->GetChannel());
+        if (up)
+        {
+            channel->Reattach(port.device);
+        }
+        else
+        {
+            channel->Detach(port.device);
+        }
+
+        std::ostringstream cmd;
+        cmd << "port-mod port=" << port.portNo << ",addr="
+            << Mac48Address::ConvertFrom(port.device->GetAddress())
+            << ",conf=" << (up ? "0x0" : "0x1") << ",mask=0x1";
+        Simulator::Schedule(m_detectionDelay,
+                            &FaultInjector::PortMod,
+                            port.controller,
+                            port.dpId,
+                            cmd.str());
+    }
+
+    /** Deliver the port state change to the switch. */
+    static void PortMod(Ptr<OFSwitch13Controller> controller, uint64_t dpId, std::string cmd)
+    {
+        controller->DpctlExecute(dpId, cmd);
+    }
+
+    /** \return the times in [start, end], from a sorted list. */
+    static uint64_t CountIn(const std::vector<Time>& times, Time start, Time end)
+    {
+        return std::upper_bound(times.begin(), times.end(), end) -
+               std::lower_bound(times.begin(), times.end(), start);
+    }
+
+    static void ProbeTx(FaultInjector* injector, Ptr<const Packet> packet)
+    {
+        injector->m_probeTxTimes.push_back(Simulator::Now());
+    }
+
+    static void ProbeRx(FaultInjector* injector, Ptr<const Packet> packet, const Address& from)
+    {
+        Time now = Simulator::Now();
+        injector->m_probeRxTimes.push_back(now);
+        if (!injector->m_outages.empty())
+        {
+            Outage& outage = injector->m_outages.back();
+            Time gap = now - Max(injector->m_lastRx, outage.start);
+            if (gap > outage.maxGap)
+            {
+                outage.maxGap = gap;
+                outage.gapEnd = now;
+                outage.recovered = true;
+            }
+        }
+        injector->m_lastRx = now;
+    }
+
+    Time m_detectionDelay;
+    std::map<std::string, Port> m_ports;
+    std::map<std::string, std::pair<std::string, std::string>> m_links;
+    std::vector<Outage> m_outages;
+    std::vector<Time> m_probeTxTimes; //!< Probe send times, in order
+    std::vector<Time> m_probeRxTimes; //!< Probe receive times, in order
+    Time m_lastRx;
+};
+
+} // namespace ns3
+
+#endif /* FAULT_INJECTOR_H */
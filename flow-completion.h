@@ -0,0 +1,193 @@
+/*
+ * Flow completion time (FCT) tracking for finite TCP transfers.
+ *
+ * Each tracked flow is a PacketSink that should receive a known number of
+ * bytes. The tracker listens to the sink's Rx trace and records the time the
+ * last byte arrived. FCT is measured from the flow's start time, and the
+ * slowdown compares it with the ideal FCT of the same transfer on an idle
+ * path: a fixed latency (handshake plus propagation) plus the transfer
+ * serialized at the bottleneck rate.
+ */
+
+#ifndef FLOW_COMPLETION_H
+#define FLOW_COMPLETION_H
+
+#include <ns3/applications-module.h>
+#include <ns3/core-module.h>
+#include <ns3/network-module.h>
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Records per-flow completion times and reports slowdown by flow size.
+ */
+class FctTracker : public SimpleRefCount<FctTracker>
+{
+  public:
+    FctTracker()
+        : m_bottleneck("100Mbps"),
+          m_baseLatency(MilliSeconds(18))
+    {
+    }
+
+    /**
+     * Define the ideal FCT of a flow of S bytes as latency + S / rate.
+     * \param bottleneck The bottleneck link rate of the path.
+     * \param baseLatency Fixed latency: TCP handshake plus one-way propagation.
+     */
+    void SetIdeal(DataRate bottleneck, Time baseLatency)
+    {
+        m_bottleneck = bottleneck;
+        m_baseLatency = baseLatency;
+    }
+
+    /**
+     * Flow size buckets: small < smallMax <= medium < mediumMax <= large.
+     * \param smallMax Upper bound (exclusive) of small flows, in bytes.
+     * \param mediumMax Upper bound (exclusive) of medium flows, in bytes.
+     */
+    void SetBuckets(uint64_t smallMax, uint64_t mediumMax)
+    {
+        m_smallMax = smallMax;
+        m_mediumMax = mediumMax;
+    }
+
+    /**
+     * Track one flow.
+     * \param sink The receiving application.
+     * \param bytes The flow size.
+     * \param start The time the sender starts.
+     * \return the flow index used in the per-flow output.
+     */
+    uint32_t Track(Ptr<PacketSink> sink, uint64_t bytes, Time start)
+    {
+        uint32_t idx = m_flows.size();
+        m_flows.push_back({bytes, 0, start, Time(0), false});
+        sink->TraceConnectWithoutContext("Rx", MakeBoundCallback(&FctTracker::Received, this, idx));
+        return idx;
+    }
+
+    /**
+     * Print completed flow counts and FCT slowdown per size bucket.
+     */
+    void Report() const
+    {
+        static const char* names[] = {"small", "medium", "large"};
+        std::vector<double> slowdown[3];
+        std::vector<double> fct[3];
+        uint32_t flows[3] = {0, 0, 0};
+        for (const auto& flow : m_flows)
+        {
+            uint32_t b = Bucket(flow.bytes);
+            flows[b]++;
+            if (flow.done)
+            {
+                fct[b].push_back(flow.fct.GetSeconds());
+                slowdown[b].push_back(flow.fct.GetSeconds() / Ideal(flow.bytes).GetSeconds());
+            }
+        }
+
+        NS_LOG_UNCOND("--------Flow completion times----------" << std::endl);
+        for (uint32_t b = 0; b < 3; b++)
+        {
+            NS_LOG_UNCOND("FCT " << names[b] << " flows =" << flows[b]
+                                 << " completed =" << fct[b].size());
+            if (fct[b].empty())
+            {
+                continue;
+            }
+            NS_LOG_UNCOND("FCT " << names[b] << " mean =" << Mean(fct[b]) << "s"
+                                 << " p99 =" << Percentile(fct[b], 0.99) << "s");
+            NS_LOG_UNCOND("FCT " << names[b] << " slowdown mean =" << Mean(slowdown[b])
+                                 << " p50 =" << Percentile(slowdown[b], 0.50)
+                                 << " p99 =" << Percentile(slowdown[b], 0.99));
+        }
+    }
+
+    /**
+     * Write one line per flow: index, bytes, start, FCT and slowdown
+     * (FCT is -1 for flows that did not complete).
+     * \param filename The output file name.
+     */
+    void WriteFlows(std::string filename) const
+    {
+        std::ofstream out(filename);
+        out << "#flow bytes start_s fct_s slowdown\n";
+        for (uint32_t i = 0; i < m_flows.size(); i++)
+        {
+            const Flow& flow = m_flows[i];
+            double fct = flow.done ? flow.fct.GetSeconds() : -1;
+            double slowdown = flow.done ? fct / Ideal(flow.bytes).GetSeconds() : -1;
+            out << i << " " << flow.bytes << " " << flow.start.GetSeconds() << " " << fct << " "
+                << slowdown << "\n";
+        }
+    }
+
+  private:
+    /** Per-flow state. */
+    struct Flow
+    {
+        uint64_t bytes;
+        uint64_t received;
+        Time start;
+        Time fct;
+        bool done;
+    };
+
+    /** PacketSink Rx trace sink. */
+    static void Received(FctTracker* tracker,
+                         uint32_t idx,
+                         Ptr<const Packet> packet,
+                         const Address& from)
+    {
+        Flow& flow = tracker->m_flows[idx];
+        flow.received += packet->GetSize();
+        if (!flow.done && flow.received >= flow.bytes)
+        {
+            flow.done = true;
+            flow.fct = Simulator::Now() - flow.start;
+        }
+    }
+
+    Time Ideal(uint64_t bytes) const
+    {
+        return m_baseLatency + m_bottleneck.CalculateBytesTxTime(bytes);
+    }
+
+    uint32_t Bucket(uint64_t bytes) const
+    {
+        return bytes < m_smallMax ? 0 : (bytes < m_mediumMax ? 1 : 2);
+    }
+
+    static double Mean(const std::vector<double>& v)
+    {
+        double sum = 0;
+        for (double x : v)
+        {
+            sum += x;
+        }
+        return sum / v.size();
+    }
+
+    static double Percentile(std::vector<double> v, double p)
+    {
+        std::sort(v.begin(), v.end());
+        return v[std::min<size_t>(v.size() - 1, p * v.size())];
+    }
+
+    DataRate m_bottleneck;
+    Time m_baseLatency;
+    uint64_t m_smallMax{100000};
+    uint64_t m_mediumMax{10000000};
+    std::vector<Flow> m_flows;
+};
+
+} // namespace ns3
+
+#endif /* FLOW_COMPLETION_H */
@@ -0,0 +1,485 @@
+/*
+ * Domain controller with a BGP-like inter-domain reachability exchange.
+ *
+ * Each controller manages the switch of one domain and originates the IPv4
+ * prefixes of the domain's hosts. Controllers of adjacent domains exchange
+ * path-vector updates: every advertised route carries the list of domains
+ * it crosses, a route that already contains the receiver is discarded, and
+ * the best route to each prefix (shortest domain path, then lowest
+ * neighbor domain ID) is installed as an ip_dst prefix entry towards the
+ * neighbor's inter-domain link and advertised to the other neighbors.
+ *
+ * Sessions run over a management network modeled as a fixed one-way delay
+ * between two controllers, and follow the state of the inter-domain link
+ * they serve: when the link port goes down, the routes learned over it are
+ * withdrawn; when it comes back, the full table is advertised again.
+ * Changes are batched per neighbor and sent at most once per minimum route
+ * advertisement interval, as BGP does, and every update is counted with
+ * the size of the BGP UPDATE message carrying the same routes.
+ *
+ * Inter-domain link ports are blocked for flooding and learning: only
+ * routed IPv4 traffic crosses domains, so hosts need static ARP entries.
+ */
+
+#ifndef INTER_DOMAIN_CONTROLLER_H
+#define INTER_DOMAIN_CONTROLLER_H
+
+#include "domain-controller.h"
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Domain controller that exchanges path-vector reachability with the
+ * controllers of adjacent domains.
+ */
+class InterDomainController : public DomainController
+{
+  public:
+    /** Domains crossed by a route, nearest first. */
+    typedef std::vector<uint32_t> DomainPath_t;
+
+    /** A prefix: network address and prefix length. */
+    typedef std::pair<uint32_t, uint8_t> PrefixKey_t;
+
+    /** One reachability update between two controllers. */
+    struct Update
+    {
+        std::vector<std::pair<PrefixKey_t, DomainPath_t>> announced;
+        std::vector<PrefixKey_t> withdrawn;
+    };
+
+    InterDomainController()
+    {
+    }
+
+    static TypeId GetTypeId()
+    {
+        static TypeId tid = TypeId("ns3::InterDomainController")
+                                .SetParent<DomainController>()
+                                .AddConstructor<InterDomainController>();
+        return tid;
+    }
+
+    void DoDispose() override
+    {
+        for (auto& n : m_neighbors)
+        {
+            Simulator::Cancel(n.flush);
+        }
+        m_neighbors.clear();
+        m_rib.clear();
+        DomainController::DoDispose();
+    }
+
+    /**
+     * \param domain This domain's ID, carried in route paths.
+     * \param dpId The datapath ID of the domain's switch.
+     */
+    void SetDomain(uint32_t domain, uint64_t dpId)
+    {
+        m_domain = domain;
+        m_dpId = dpId;
+    }
+
+    /**
+     * Advertise a prefix of this domain once the exchange starts.
+     * \param prefix The network address.
+     * \param mask The network mask.
+     */
+    void Originate(Ipv4Address prefix, Ipv4Mask mask)
+    {
+        m_originated.push_back(Key(prefix, mask));
+    }
+
+    /**
+     * Peer with the controller of an adjacent domain. Both controllers
+     * must have their domain set.
+     * \param peer The neighbor controller.
+     * \param port Local port of the inter-domain link to the neighbor.
+     * \param delay One-way delay of the management network between the two.
+     */
+    void AddNeighbor(Ptr<InterDomainController> peer, uint32_t port, Time delay)
+    {
+        Neighbor n;
+        n.peer = peer;
+        n.domain = peer->m_domain;
+        n.port = port;
+        n.delay = delay;
+        m_neighbors.push_back(n);
+        BlockPort(m_dpId, port);
+    }
+
+    /**
+     * \param mrai Minimum time between two updates to the same neighbor.
+     */
+    void SetAdvertisementInterval(Time mrai)
+    {
+        m_mrai = mrai;
+    }
+
+    /** Start the exchange: advertise the originated prefixes. */
+    void StartExchange()
+    {
+        for (const auto& key : m_originated)
+        {
+            m_rib[key].local = true;
+            Decide(key);
+        }
+    }
+
+    /** \return the updates sent to the neighbors. */
+    uint64_t GetUpdatesSent() const
+    {
+        return m_updatesSent;
+    }
+
+    /** \return the bytes of the updates sent, sized as BGP UPDATE messages. */
+    uint64_t GetUpdateBytes() const
+    {
+        return m_updateBytes;
+    }
+
+    /** \return the routes announced to the neighbors. */
+    uint64_t GetRoutesAnnounced() const
+    {
+        return m_routesAnnounced;
+    }
+
+    /** \return the routes withdrawn from the neighbors. */
+    uint64_t GetRoutesWithdrawn() const
+    {
+        return m_routesWithdrawn;
+    }
+
+    /** \return the number of best route changes. */
+    uint64_t GetRibChanges() const
+    {
+        return m_ribChanges;
+    }
+
+    /** \return the time of the last best route change. */
+    Time GetLastChange() const
+    {
+        return m_lastChange;
+    }
+
+    /** \return the number of prefixes with a route, own ones included. */
+    uint32_t GetReachable() const
+    {
+        uint32_t reachable = 0;
+        for (const auto& entry : m_rib)
+        {
+            reachable += (entry.second.best != NO_ROUTE) ? 1 : 0;
+        }
+        return reachable;
+    }
+
+    /** \return the longest best route, in domains. */
+    uint32_t GetLongestPath() const
+    {
+        size_t longest = 0;
+        for (const auto& entry : m_rib)
+        {
+            longest = std::max(longest, entry.second.path.size());
+        }
+        return longest;
+    }
+
+  protected:
+    static constexpr int32_t NO_ROUTE = -1;    //!< No best route
+    static constexpr int32_t LOCAL_ROUTE = -2; //!< Originated here
+
+    /** Routing state of one prefix. */
+    struct RibEntry
+    {
+        bool local{false};                     //!< Originated here
+        std::map<uint32_t, DomainPath_t> adjIn; //!< Paths heard, by neighbor index
+        int32_t best{NO_ROUTE};                //!< Neighbor index of the best route
+        DomainPath_t path;                     //!< Best path, starting here
+    };
+
+    /** Session with an adjacent domain's controller. */
+    struct Neighbor
+    {
+        Ptr<InterDomainController> peer;
+        uint32_t domain;
+        uint32_t port;                           //!< Local inter-domain link port
+        Time delay;                              //!< One-way management network delay
+        bool up{true};                           //!< Inter-domain link state
+        std::map<PrefixKey_t, DomainPath_t> adjOut; //!< Paths advertised to it
+        std::set<PrefixKey_t> pending;           //!< Prefixes to reconsider
+        EventId flush;
+        bool sent{false};
+        Time lastSent;
+    };
+
+    void HandshakeSuccessful(Ptr<const RemoteSwitch> swtch) override
+    {
+        DomainController::HandshakeSuccessful(swtch);
+        for (const auto& entry : m_rib)
+        {
+            if (entry.second.best >= 0)
+            {
+                InstallRoute(m_dpId, ToRoute(entry.first, entry.second.best));
+            }
+        }
+    }
+
+    ofl_err HandlePortStatus(struct ofl_msg_port_status* msg,
+                             Ptr<const RemoteSwitch> swtch,
+                             uint32_t xid) override
+    {
+        uint32_t portNo = msg->desc->port_no;
+        bool up = IsUp(msg->desc) && msg->reason != OFPPR_DELETE;
+
+        // The base class flushes the entries using a failed port first.
+        ofl_err err = DomainController::HandlePortStatus(msg, swtch, xid);
+        for (uint32_t i = 0; i < m_neighbors.size(); i++)
+        {
+            if (m_neighbors[i].port == portNo && m_neighbors[i].up != up)
+            {
+                SetSessionState(i, up);
+            }
+        }
+        return err;
+    }
+
+    /**
+     * Bring a session down (withdrawing everything learned over it) or up
+     * (advertising the full table).
+     */
+    void SetSessionState(uint32_t idx, bool up)
+    {
+        Neighbor& n = m_neighbors[idx];
+        n.up = up;
+        if (!up)
+        {
+            Simulator::Cancel(n.flush);
+            n.adjOut.clear();
+            n.pending.clear();
+            for (auto& entry : m_rib)
+            {
+                if (entry.second.adjIn.erase(idx))
+                {
+                    Decide(entry.first);
+                }
+            }
+            return;
+        }
+        for (const auto& entry : m_rib)
+        {
+            n.pending.insert(entry.first);
+        }
+        ScheduleFlush(idx);
+    }
+
+    /** Handle an update from the controller of an adjacent domain. */
+    void Receive(uint32_t from, Update update)
+    {
+        uint32_t idx = 0;
+        while (idx < m_neighbors.size() && m_neighbors[idx].domain != from)
+        {
+            idx++;
+        }
+        if (!m_alive || idx == m_neighbors.size() || !m_neighbors[idx].up)
+        {
+            return;
+        }
+        for (const auto& key : update.withdrawn)
+        {
+            m_rib[key].adjIn.erase(idx);
+            Decide(key);
+        }
+        for (const auto& route : update.announced)
+        {
+            const DomainPath_t& path = route.second;
+            if (std::find(path.begin(), path.end(), m_domain) != path.end())
+            {
+                // Loop: the path replaces (withdraws) the neighbor's previous one.
+                m_rib[route.first].adjIn.erase(idx);
+            }
+            else
+            {
+                m_rib[route.first].adjIn[idx] = path;
+            }
+            Decide(route.first);
+        }
+    }
+
+    /**
+     * Select the best route to a prefix. On a change, update the switch
+     * and queue the prefix for all neighbors.
+     */
+    void Decide(const PrefixKey_t& key)
+    {
+        RibEntry& entry = m_rib[key];
+        int32_t best = NO_ROUTE;
+        DomainPath_t path;
+        if (entry.local)
+        {
+            best = LOCAL_ROUTE;
+            path.push_back(m_domain);
+        }
+        else
+        {
+            for (const auto& in : entry.adjIn)
+            {
+                if (best == NO_ROUTE || in.second.size() + 1 < path.size() ||
+                    (in.second.size() + 1 == path.size() &&
+                     m_neighbors[in.first].domain < m_neighbors[best].domain))
+                {
+                    best = in.first;
+                    path.assign(1, m_domain);
+                    path.insert(path.end(), in.second.begin(), in.second.end());
+                }
+            }
+        }
+        if (best == entry.best && path == entry.path)
+        {
+            return;
+        }
+
+        bool moved = (best != entry.best);
+        entry.best = best;
+        entry.path = path;
+        m_ribChanges++;
+        m_lastChange = Simulator::Now();
+        if (moved && m_switches[m_dpId].remote)
+        {
+            if (best >= 0)
+            {
+                // An add with the same match and priority replaces the entry.
+                InstallRoute(m_dpId, ToRoute(key, best));
+            }
+            else if (best == NO_ROUTE)
+            {
+                std::ostringstream cmd;
+                cmd << "flow-mod cmd=del,table=" << m_l2Table
+                    << " eth_type=0x800,ip_dst=" << Ipv4Address(key.first) << "/"
+                    << (uint32_t)key.second;
+                DpctlExecute(m_dpId, cmd.str());
+                m_flowMods++;
+            }
+        }
+        for (uint32_t i = 0; i < m_neighbors.size(); i++)
+        {
+            if (m_neighbors[i].up)
+            {
+                m_neighbors[i].pending.insert(key);
+                ScheduleFlush(i);
+            }
+        }
+    }
+
+    /** Send the pending changes now, or once the MRAI has passed. */
+    void ScheduleFlush(uint32_t idx)
+    {
+        Neighbor& n = m_neighbors[idx];
+        if (!n.flush.IsExpired())
+        {
+            return;
+        }
+        Time wait = n.sent ? Max(Time(0), n.lastSent + m_mrai - Simulator::Now()) : Time(0);
+        n.flush = Simulator::Schedule(wait, &InterDomainController::Flush, this, idx);
+    }
+
+    /**
+     * Send one update with the difference between the best routes of the
+     * pending prefixes and what the neighbor was told. A route is never
+     * advertised back to the neighbor it was learned from.
+     */
+    void Flush(uint32_t idx)
+    {
+        Neighbor& n = m_neighbors[idx];
+        Update update;
+        for (const auto& key : n.pending)
+        {
+            const RibEntry& entry = m_rib[key];
+            auto out = n.adjOut.find(key);
+            if (entry.best != NO_ROUTE && entry.best != (int32_t)idx)
+            {
+                if (out == n.adjOut.end() || out->second != entry.path)
+                {
+                    update.announced.push_back({key, entry.path});
+                    n.adjOut[key] = entry.path;
+                }
+            }
+            else if (out != n.adjOut.end())
+            {
+                update.withdrawn.push_back(key);
+                n.adjOut.erase(out);
+            }
+        }
+        n.pending.clear();
+        if (!m_alive || (update.announced.empty() && update.withdrawn.empty()))
+        {
+            return;
+        }
+        n.sent = true;
+        n.lastSent = Simulator::Now();
+        m_updatesSent++;
+        m_updateBytes += UpdateSize(update);
+        m_routesAnnounced += update.announced.size();
+        m_routesWithdrawn += update.withdrawn.size();
+        Simulator::Schedule(n.delay, &InterDomainController::Receive, n.peer, m_domain, update);
+    }
+
+    /**
+     * \return the size of a BGP UPDATE (RFC 4271) carrying the same routes,
+     *         with ORIGIN, AS_PATH and NEXT_HOP attributes for each.
+     */
+    static uint32_t UpdateSize(const Update& update)
+    {
+        uint32_t size = 19 + 2 + 2; // header, withdrawn and attribute lengths
+        for (const auto& key : update.withdrawn)
+        {
+            size += 1 + (key.second + 7) / 8;
+        }
+        for (const auto& route : update.announced)
+        {
+            size += 1 + (route.first.second + 7) / 8;
+            size += 4 + (3 + 2 + 4 * route.second.size()) + 7;
+        }
+        return size;
+    }
+
+    /** \return the key of a prefix. */
+    static PrefixKey_t Key(Ipv4Address prefix, Ipv4Mask mask)
+    {
+        return {prefix.CombineMask(mask).Get(), mask.GetPrefixLength()};
+    }
+
+    /** \return the switch route of a prefix through a neighbor. */
+    PrefixRoute ToRoute(const PrefixKey_t& key, int32_t idx) const
+    {
+        uint32_t bits = key.second ? ~0U << (32 - key.second) : 0;
+        return {Ipv4Address(key.first), Ipv4Mask(bits), m_neighbors[idx].port};
+    }
+
+    uint32_t m_domain{0};
+    uint64_t m_dpId{0};
+    Time m_mrai;
+    std::vector<PrefixKey_t> m_originated;
+    std::vector<Neighbor> m_neighbors;
+    std::map<PrefixKey_t, RibEntry> m_rib;
+    uint64_t m_updatesSent{0};
+    uint64_t m_updateBytes{0};
+    uint64_t m_routesAnnounced{0};
+    uint64_t m_routesWithdrawn{0};
+    uint64_t m_ribChanges{0};
+    Time m_lastChange;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(InterDomainController);
+
+} // namespace ns3
+
+#endif /* INTER_DOMAIN_CONTROLLER_H */
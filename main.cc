@@ -19,7 +19,13 @@
  *         Vitor M. Eichemberger <vitor.marge@gmail.com>
  *
  * Two hosts connected to different OpenFlow switches.
- * Each switch is managed by an independent default learning controller application.
+ * Each switch is managed by an independent learning controller application.
+ * Optional bulk hosts on switch 0 load the inter-switch link, and the qos
+ * mode gives the ping priority over them. With lazyExpiry the controllers
+ * age the learned entries, and the datapath timeout can be made coarse so
+ * idle switches stop polling their tables. With tableStats the flow tables
+ * are polled for their search cost per packet, and flowCache moves the
+ * busiest destinations to the head of the forwarding tables.
  *
  *            Learning Controller   Learning Controller
  *                    |                     |
@@ -35,15 +41,49 @@
 #include <ns3/ofswitch13-module.h>
 #include <ns3/internet-apps-module.h>
 #include <ns3/flow-monitor-module.h>
+#include <ns3/applications-module.h>
+
+#include "domain-controller.h"
+#include "pcapng-capture.h"
+
+#include <algorithm>
+#include <vector>
 
 using namespace ns3;
 
+/* Collect ping round-trip times */
+static void
+RecordRtt (std::vector<Time> *rtts, Time rtt)
+{
+  rtts->push_back (rtt);
+}
+
+/* Take the number of events executed so far */
+static void
+SampleEvents (uint64_t *events)
+{
+  *events = Simulator::GetEventCount ();
+}
+
 int
 main (int argc, char *argv[])
 {
     uint16_t simTime = 10;
     bool verbose = false;
     bool trace = false;
+    uint32_t snapLen = 0;
+    uint32_t sampleRate = 1;
+    bool sampleFlows = false;
+    bool qos = false;
+    uint32_t bulkHosts = 0;
+    std::string bulkRate = "60Mbps";
+    std::string meterRate = "90Mbps";
+    double pingInterval = 1;
+    bool lazyExpiry = false;
+    double datapathTimeout = 0;
+    double trafficStop = 0;
+    double tableStats = 0;
+    uint32_t flowCache = 0;
     uint32_t SentPackets = 0;
     uint32_t ReceivedPackets = 0;
     uint32_t LostPackets = 0;
@@ -54,7 +94,24 @@ main (int argc, char *argv[])
     cmd.AddValue ("simTime", "Simulation time (seconds)", simTime);
     cmd.AddValue ("verbose", "Enable verbose output", verbose);
     cmd.AddValue ("trace", "Enable datapath stats and pcap traces", trace);
+    cmd.AddValue ("snapLen", "Captured bytes per frame (0 for full frames)", snapLen);
+    cmd.AddValue ("sampleRate", "Capture one in N packets (or flows)", sampleRate);
+    cmd.AddValue ("sampleFlows", "Sample whole flows instead of packets", sampleFlows);
+    cmd.AddValue ("qos", "Meter bulk traffic and give ICMP a priority queue", qos);
+    cmd.AddValue ("bulkHosts", "Hosts on switch 0 sending bulk UDP to host 1", bulkHosts);
+    cmd.AddValue ("bulkRate", "Bulk UDP rate of each bulk host", bulkRate);
+    cmd.AddValue ("meterRate", "Meter rate for bulk traffic in qos mode", meterRate);
+    cmd.AddValue ("pingInterval", "Ping interval (seconds)", pingInterval);
+    cmd.AddValue ("lazyExpiry", "Age learned entries in the controllers", lazyExpiry);
+    cmd.AddValue ("datapathTimeout", "Datapath timeout interval (seconds, 0 for the default;"
+                  " it also refills the qos meters)", datapathTimeout);
+    cmd.AddValue ("trafficStop", "Stop the traffic here and idle until simTime (seconds, 0 to never stop)",
+                  trafficStop);
+    cmd.AddValue ("tableStats", "Flow table polling period (seconds, 0 to disable)", tableStats);
+    cmd.AddValue ("flowCache", "Destinations cached at the head of each forwarding table (0 to disable)",
+                  flowCache);
     cmd.Parse (argc, argv);
+    NS_ABORT_MSG_IF (flowCache && lazyExpiry, "flowCache and lazyExpiry cannot be combined");
 
     if (verbose)
     {
@@ -73,9 +130,22 @@ main (int argc, char *argv[])
     // Enable checksum computations (required by OFSwitch13 module)
     GlobalValue::Bind ("ChecksumEnabled", BooleanValue (true));
 
-    // Create two host nodes
+    // The datapath scans its tables for timeouts at every interval
+    if (datapathTimeout > 0)
+    {
+        Config::SetDefault ("ns3::OFSwitch13Device::TimeoutInterval",
+                            TimeValue (Seconds (datapathTimeout)));
+    }
+
+    // Strict priority port queues: queue 0 for ICMP, queue 1 for the rest
+    if (qos)
+    {
+        Config::SetDefault ("ns3::OFSwitch13Queue::NumQueues", UintegerValue (2));
+    }
+
+    // Create two host nodes, plus the bulk hosts
     NodeContainer hosts;
-    hosts.Create (2);
+    hosts.Create (2 + bulkHosts);
 
     // Create two switch nodes
     NodeContainer switches;
@@ -111,18 +181,47 @@ main (int argc, char *argv[])
     switchPorts [0].Add (pairDevs.Get (0));
     switchPorts [1].Add (pairDevs.Get (1));
 
+    // Connect the bulk hosts to first switch
+    for (uint32_t i = 0; i < bulkHosts; i++)
+    {
+        pair = NodeContainer (hosts.Get (2 + i), switches.Get (0));
+        pairDevs = csmaHelper.Install (pair);
+        hostDevices.Add (pairDevs.Get (0));
+        switchPorts [0].Add (pairDevs.Get (1));
+    }
+
     // Create two controller nodes
     NodeContainer controllers;
     controllers.Create (2);
 
     // Configure both OpenFlow network domains
+    Ptr<DomainController> ctrl0 = CreateObject<DomainController> ();
+    Ptr<DomainController> ctrl1 = CreateObject<DomainController> ();
+    if (qos)
+    {
+        ctrl0->SetQos (DataRate (meterRate));
+        ctrl1->SetQos (DataRate (meterRate));
+    }
+    ctrl0->SetLazyExpiry (lazyExpiry);
+    ctrl1->SetLazyExpiry (lazyExpiry);
+    if (tableStats > 0)
+    {
+        ctrl0->StartTableStats (Seconds (tableStats), "table-stats-0.txt");
+        ctrl1->StartTableStats (Seconds (tableStats), "table-stats-1.txt");
+    }
+    if (flowCache)
+    {
+        ctrl0->StartFlowCache (flowCache, Seconds (1));
+        ctrl1->StartFlowCache (flowCache, Seconds (1));
+    }
+
     Ptr<OFSwitch13InternalHelper> of13Helper0 = CreateObject<OFSwitch13InternalHelper> ();
-    of13Helper0->InstallController (controllers.Get (0));
+    of13Helper0->InstallController (controllers.Get (0), ctrl0);
     of13Helper0->InstallSwitch (switches.Get (0), switchPorts [0]);
     of13Helper0->CreateOpenFlowChannels ();
 
     Ptr<OFSwitch13InternalHelper> of13Helper1 = CreateObject<OFSwitch13InternalHelper> ();
-    of13Helper1->InstallController (controllers.Get (1));
+    of13Helper1->InstallController (controllers.Get (1), ctrl1);
     of13Helper1->InstallSwitch (switches.Get (1), switchPorts [1]);
     of13Helper1->CreateOpenFlowChannels ();
 
@@ -138,20 +237,50 @@ main (int argc, char *argv[])
 
     // Configure ping application between hosts
     V4PingHelper pingHelper = V4PingHelper (hostIpIfaces.GetAddress (1));
-    pingHelper.SetAttribute ("Verbose", BooleanValue (true));
+    pingHelper.SetAttribute ("Verbose", BooleanValue (pingInterval >= 1));
+    pingHelper.SetAttribute ("Interval", TimeValue (Seconds (pingInterval)));
     ApplicationContainer pingApps = pingHelper.Install (hosts.Get (0));
+    double trafficEnd = trafficStop > 0 ? trafficStop : simTime;
     pingApps.Start (Seconds (1));
+    pingApps.Stop (Seconds (trafficEnd));
+    std::vector<Time> rtts;
+    pingApps.Get (0)->TraceConnectWithoutContext ("Rtt", MakeBoundCallback (&RecordRtt, &rtts));
+
+    // Configure bulk UDP traffic to host 1, sharing the inter-switch link
+    for (uint32_t i = 0; i < bulkHosts; i++)
+    {
+        OnOffHelper bulk ("ns3::UdpSocketFactory",
+                          InetSocketAddress (hostIpIfaces.GetAddress (1), 9));
+        bulk.SetConstantRate (DataRate (bulkRate), 10240);
+        ApplicationContainer bulkApp = bulk.Install (hosts.Get (2 + i));
+        bulkApp.Start (Seconds (1));
+        bulkApp.Stop (Seconds (trafficEnd));
+    }
 
     // Enable datapath stats and pcap traces at hosts, switch(es), and controller(s)
+    Ptr<PcapngCaptureSink> capture;
     if (trace)
     {
-        of13Helper0->EnableOpenFlowPcap ("openflow-0");
+        capture = Create<PcapngCaptureSink> ("main.pcapng");
+        capture->SetSnapLen (snapLen);
+        capture->SetSampling (sampleFlows ? PcapngCaptureSink::SAMPLE_FLOWS : PcapngCaptureSink::SAMPLE_PACKETS,
+                              sampleRate);
+        capture->AddNodeDevices (controllers.Get (0), "openflow-0", true);
         of13Helper0->EnableDatapathStats ("switch-stats");
-        of13Helper1->EnableOpenFlowPcap ("openflow-1");
+        capture->AddNodeDevices (controllers.Get (1), "openflow-1", true);
         of13Helper1->EnableDatapathStats ("switch-stats");
-        csmaHelper.EnablePcap ("switch", switchPorts [0], true);
-        csmaHelper.EnablePcap ("switch", switchPorts [1], true);
-        csmaHelper.EnablePcap ("host", hostDevices);
+        capture->AddDevices (switchPorts [0], "switch", true);
+        capture->AddDevices (switchPorts [1], "switch", true);
+        capture->AddDevices (hostDevices, "host", false);
+    }
+
+    // Count the events once the learned entries have had two idle timeouts
+    // to expire after the traffic stopped
+    double idleStart = trafficEnd + 21;
+    uint64_t idleStartEvents = 0;
+    if (idleStart < simTime)
+    {
+        Simulator::Schedule (Seconds (idleStart), &SampleEvents, &idleStartEvents);
     }
 
     // Run the simulation
@@ -159,6 +288,14 @@ main (int argc, char *argv[])
     FlowMonitorHelper flowmon;
     Ptr<FlowMonitor> monitor = flowmon.InstallAll();
     Simulator::Run ();
+    if (capture)
+    {
+        capture->Close ();
+        NS_LOG_UNCOND("Captured frames =" << capture->GetCapturedFrames ()
+                      << " dropped =" << capture->GetDroppedFrames ()
+                      << " sampled out =" << capture->GetSampledOutFrames ()
+                      << " bytes =" << capture->GetCapturedBytes ());
+    }
     int j=0;
     float AvgThroughput = 0;
     Time Jitter;
@@ -204,6 +341,42 @@ main (int argc, char *argv[])
     NS_LOG_UNCOND("End to End Delay =" << Delay);
     NS_LOG_UNCOND("End to End Jitter delay =" << Jitter);
     NS_LOG_UNCOND("Total Flod id " << j);
+    if (!rtts.empty ())
+    {
+        std::sort (rtts.begin (), rtts.end ());
+        NS_LOG_UNCOND("Latency class (ping) " << (qos ? "with" : "without") << " QoS: replies ="
+                      << rtts.size ()
+                      << " p50 RTT =" << rtts [rtts.size () / 2].GetSeconds () * 1000 << "ms"
+                      << " p99 RTT ="
+                      << rtts [std::min<size_t> (rtts.size () - 1, rtts.size () * 0.99)].GetSeconds () * 1000
+                      << "ms");
+    }
+    if (tableStats > 0 || flowCache)
+    {
+        NS_LOG_UNCOND("--------Flow tables----------" << std::endl);
+        ctrl0->ReportFlowTables ();
+        ctrl1->ReportFlowTables ();
+    }
+    if (flowCache)
+    {
+        NS_LOG_UNCOND("Flow cache size =" << flowCache << " entries moved ="
+                      << ctrl0->GetCacheMoves () + ctrl1->GetCacheMoves ());
+    }
+    uint64_t events = Simulator::GetEventCount ();
+    NS_LOG_UNCOND("--------Event load----------"<<std::endl);
+    NS_LOG_UNCOND("Flow expiry =" << (lazyExpiry ? "controller" : "datapath")
+                  << " datapath timeout interval ="
+                  << (datapathTimeout > 0 ? datapathTimeout * 1000 : 100) << "ms");
+    NS_LOG_UNCOND("Events =" << events << " events per simulated second =" << events / (double) simTime);
+    if (idleStart < simTime)
+    {
+        NS_LOG_UNCOND("Events per simulated second at idle (from " << idleStart << "s) ="
+                      << (events - idleStartEvents) / (simTime - idleStart));
+    }
+    if (lazyExpiry)
+    {
+        NS_LOG_UNCOND("Expiry checks =" << ctrl0->GetExpiryChecks () + ctrl1->GetExpiryChecks ());
+    }
     monitor->SerializeToXmlFile("manet-routing.xml", true, true);
     Simulator::Destroy ();
 }
\ No newline at end of file
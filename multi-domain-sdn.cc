@@ -0,0 +1,360 @@
+/*
+ * N-domain SDN scenario with inter-domain reachability exchange.
+ *
+ * Every domain is one OpenFlow switch with its hosts and its own
+ * controller. The switches are connected by an inter-domain graph (line,
+ * ring, mesh, star, random or an explicit edge list), and the controllers
+ * of adjacent domains exchange BGP-like path-vector updates for the /24 of
+ * each domain (10.1.<domain>.0/24), installing one prefix entry per remote
+ * domain. The run reports the control-plane convergence time and the
+ * update volume, so both can be compared as domains are added.
+ *
+ *   Controller 0 <- - - - -> Controller 1 <- - - - -> Controller 2 ...
+ *        |                        |                        |
+ *   +----------+            +----------+            +----------+
+ *   | Switch 0 | ========== | Switch 1 | ========== | Switch 2 | ...
+ *   +----------+            +----------+            +----------+
+ *       hosts                   hosts                   hosts
+ */
+
+#include <ns3/applications-module.h>
+#include <ns3/core-module.h>
+#include <ns3/csma-module.h>
+#include <ns3/flow-monitor-module.h>
+#include <ns3/internet-module.h>
+#include <ns3/network-module.h>
+#include <ns3/ofswitch13-module.h>
+
+#include "fault-injector.h"
+#include "inter-domain-controller.h"
+#include "static-arp.h"
+#include "traffic-matrix.h"
+
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+using namespace ns3;
+
+/** An inter-domain link. */
+struct DomainLink
+{
+    uint32_t a, b;         // domain indexes
+    uint32_t portA, portB; // OpenFlow port numbers
+};
+
+/**
+ * \return the domain pairs to connect, each with a < b.
+ */
+static std::vector<std::pair<uint32_t, uint32_t>>
+BuildGraph(std::string topology, uint32_t nDomains, double linkProb)
+{
+    std::vector<std::pair<uint32_t, uint32_t>> edges;
+    if (topology == "line" || topology == "ring")
+    {
+        for (uint32_t d = 0; d + 1 < nDomains; d++)
+        {
+            edges.push_back({d, d + 1});
+        }
+        if (topology == "ring" && nDomains > 2)
+        {
+            edges.push_back({0, nDomains - 1});
+        }
+    }
+    else if (topology == "mesh")
+    {
+        for (uint32_t a = 0; a < nDomains; a++)
+        {
+            for (uint32_t b = a + 1; b < nDomains; b++)
+            {
+                edges.push_back({a, b});
+            }
+        }
+    }
+    else if (topology == "star")
+    {
+        for (uint32_t d = 1; d < nDomains; d++)
+        {
+            edges.push_back({0, d});
+        }
+    }
+    else if (topology == "random")
+    {
+        // A random tree keeps the graph connected; extra links are added
+        // with probability linkProb
+        Ptr<UniformRandomVariable> rng = CreateObject<UniformRandomVariable>();
+        std::vector<std::vector<bool>> linked(nDomains, std::vector<bool>(nDomains, false));
+        for (uint32_t d = 1; d < nDomains; d++)
+        {
+            uint32_t parent = rng->GetInteger(0, d - 1);
+            edges.push_back({parent, d});
+            linked[parent][d] = true;
+        }
+        for (uint32_t a = 0; a < nDomains; a++)
+        {
+            for (uint32_t b = a + 1; b < nDomains; b++)
+            {
+                if (!linked[a][b] && rng->GetValue() < linkProb)
+                {
+                    edges.push_back({a, b});
+                }
+            }
+        }
+    }
+    else
+    {
+        // Explicit edge list, e.g. 0-1,1-2,2-0
+        std::istringstream items(topology);
+        std::string item;
+        while (std::getline(items, item, ','))
+        {
+            size_t dash = item.find('-');
+            NS_ABORT_MSG_IF(dash == std::string::npos, "Bad topology " << topology);
+            uint32_t a = std::stoul(item.substr(0, dash));
+            uint32_t b = std::stoul(item.substr(dash + 1));
+            NS_ABORT_MSG_IF(a == b || a >= nDomains || b >= nDomains, "Bad domain link " << item);
+            edges.push_back({std::min(a, b), std::max(a, b)});
+        }
+    }
+    return edges;
+}
+
+int
+main(int argc, char* argv[])
+{
+    uint16_t simTime = 10;
+    bool verbose = false;
+    uint32_t nDomains = 8;
+    uint32_t hostsPerDomain = 2;
+    std::string topology = "ring";
+    double linkProb = 0.2;
+    double ctrlDelay = 5;
+    double mrai = 0;
+    double exchangeStart = 1;
+    std::string workload = "uniform";
+    double flowRate = 20;
+    uint32_t flowSize = 100000;
+    std::string faults;
+
+    // Configure command line parameters
+    CommandLine cmd;
+    cmd.AddValue("simTime", "Simulation time (seconds)", simTime);
+    cmd.AddValue("verbose", "Enable verbose output", verbose);
+    cmd.AddValue("domains", "Number of domains, each one switch and one controller", nDomains);
+    cmd.AddValue("hostsPerDomain", "Number of hosts in each domain", hostsPerDomain);
+    cmd.AddValue("topology",
+                 "Inter-domain graph: line, ring, mesh, star, random or an edge list like 0-1,1-2",
+                 topology);
+    cmd.AddValue("linkProb", "Probability of each extra link of the random graph", linkProb);
+    cmd.AddValue("ctrlDelay", "One-way delay between controllers (ms)", ctrlDelay);
+    cmd.AddValue("mrai", "Minimum route advertisement interval (ms)", mrai);
+    cmd.AddValue("exchangeStart", "Time the controllers start advertising (seconds)", exchangeStart);
+    cmd.AddValue("workload",
+                 "Traffic matrix: uniform, permutation, hotspot, incast or a matrix file "
+                 "(empty for no data traffic)",
+                 workload);
+    cmd.AddValue("flowRate", "Workload flow arrival rate (flows/s)", flowRate);
+    cmd.AddValue("flowSize", "Mean workload flow size (bytes)", flowSize);
+    cmd.AddValue("faults",
+                 "Fault schedule, e.g. link0:down@3,link0:up@6 (targets: link<n>, s<i>p<n>)",
+                 faults);
+    cmd.Parse(argc, argv);
+
+    NS_ABORT_MSG_IF(nDomains < 2 || nDomains > 254, "Need 2 to 254 domains");
+    NS_ABORT_MSG_IF(hostsPerDomain < 1 || hostsPerDomain > 253, "Need 1 to 253 hosts per domain");
+
+    if (verbose)
+    {
+        OFSwitch13Helper::EnableDatapathLogs();
+        LogComponentEnable("OFSwitch13Controller", LOG_LEVEL_ALL);
+        LogComponentEnable("OFSwitch13InternalHelper", LOG_LEVEL_ALL);
+    }
+
+    // Enable checksum computations (required by OFSwitch13 module)
+    GlobalValue::Bind("ChecksumEnabled", BooleanValue(true));
+
+    uint32_t nHosts = nDomains * hostsPerDomain;
+    NodeContainer hosts;
+    hosts.Create(nHosts);
+    NodeContainer switches;
+    switches.Create(nDomains);
+    NodeContainer controllers;
+    controllers.Create(nDomains);
+
+    // Use the CsmaHelper to connect hosts and switches
+    CsmaHelper csmaHelper;
+    csmaHelper.SetChannelAttribute("DataRate", DataRateValue(DataRate("100Mbps")));
+    csmaHelper.SetChannelAttribute("Delay", TimeValue(MilliSeconds(2)));
+
+    NetDeviceContainer hostDevices;
+    std::vector<NetDeviceContainer> domainHostDevices(nDomains);
+    std::vector<NetDeviceContainer> switchPorts(nDomains);
+    for (uint32_t i = 0; i < nHosts; i++)
+    {
+        uint32_t d = i / hostsPerDomain;
+        NetDeviceContainer pairDevs = csmaHelper.Install(NodeContainer(hosts.Get(i), switches.Get(d)));
+        hostDevices.Add(pairDevs.Get(0));
+        domainHostDevices[d].Add(pairDevs.Get(0));
+        switchPorts[d].Add(pairDevs.Get(1));
+    }
+
+    // Connect the domains
+    std::vector<DomainLink> links;
+    for (const auto& edge : BuildGraph(topology, nDomains, linkProb))
+    {
+        NetDeviceContainer pairDevs =
+            csmaHelper.Install(NodeContainer(switches.Get(edge.first), switches.Get(edge.second)));
+        switchPorts[edge.first].Add(pairDevs.Get(0));
+        switchPorts[edge.second].Add(pairDevs.Get(1));
+        links.push_back({edge.first,
+                         edge.second,
+                         switchPorts[edge.first].GetN(),
+                         switchPorts[edge.second].GetN()});
+    }
+
+    // One OpenFlow network domain per switch
+    std::vector<Ptr<InterDomainController>> ctrls(nDomains);
+    std::vector<Ptr<OFSwitch13Device>> devices(nDomains);
+    for (uint32_t d = 0; d < nDomains; d++)
+    {
+        ctrls[d] = CreateObject<InterDomainController>();
+        Ptr<OFSwitch13InternalHelper> of13Helper = CreateObject<OFSwitch13InternalHelper>();
+        of13Helper->InstallController(controllers.Get(d), ctrls[d]);
+        devices[d] = of13Helper->InstallSwitch(switches.Get(d), switchPorts[d]);
+        of13Helper->CreateOpenFlowChannels();
+        ctrls[d]->SetDomain(d, devices[d]->GetDatapathId());
+        ctrls[d]->SetAdvertisementInterval(MilliSeconds(mrai));
+    }
+    for (const auto& link : links)
+    {
+        ctrls[link.a]->AddNeighbor(ctrls[link.b], link.portA, MilliSeconds(ctrlDelay));
+        ctrls[link.b]->AddNeighbor(ctrls[link.a], link.portB, MilliSeconds(ctrlDelay));
+    }
+
+    InternetStackHelper internet;
+    internet.Install(hosts);
+
+    // One /24 per domain inside 10.1.0.0/16
+    Ipv4AddressHelper ipv4;
+    Ipv4InterfaceContainer hostIpIfaces;
+    for (uint32_t d = 0; d < nDomains; d++)
+    {
+        ipv4.SetBase("10.1.0.0", "255.255.0.0", Ipv4Address((d << 8) | 1));
+        hostIpIfaces.Add(ipv4.Assign(domainHostDevices[d]));
+        ctrls[d]->Originate(Ipv4Address(Ipv4Address("10.1.0.0").Get() | (d << 8)),
+                            Ipv4Mask("255.255.255.0"));
+        Simulator::Schedule(Seconds(exchangeStart), &InterDomainController::StartExchange, ctrls[d]);
+    }
+
+    // Hosts are known up front: static ARP and permanent local entries
+    PopulateArp(hostIpIfaces, hostDevices);
+    for (uint32_t i = 0; i < nHosts; i++)
+    {
+        uint32_t d = i / hostsPerDomain;
+        ctrls[d]->AddStaticHost(devices[d]->GetDatapathId(),
+                                Mac48Address::ConvertFrom(hostDevices.Get(i)->GetAddress()),
+                                i % hostsPerDomain + 1,
+                                hostIpIfaces.GetAddress(i));
+    }
+
+    Ptr<TrafficMatrixWorkload> flows;
+    if (!workload.empty())
+    {
+        flows = Create<TrafficMatrixWorkload>();
+        flows->SetPattern(workload);
+        flows->SetArrivalRate(flowRate);
+        flows->SetFlowSize(flowSize, 1.2, 100 * flowSize);
+        flows->Install(hosts, hostIpIfaces, Seconds(exchangeStart + 1), Seconds(simTime));
+    }
+
+    Ptr<FaultInjector> faultInjector;
+    if (!faults.empty())
+    {
+        faultInjector = Create<FaultInjector>();
+        for (uint32_t d = 0; d < nDomains; d++)
+        {
+            faultInjector->AddSwitch(d, devices[d], switchPorts[d], ctrls[d]);
+        }
+        for (uint32_t l = 0; l < links.size(); l++)
+        {
+            std::ostringstream link;
+            std::ostringstream endA;
+            std::ostringstream endB;
+            link << "link" << l;
+            endA << "s" << links[l].a << "p" << links[l].portA;
+            endB << "s" << links[l].b << "p" << links[l].portB;
+            faultInjector->AddLink(link.str(), endA.str(), endB.str());
+        }
+        faultInjector->Schedule(faults);
+
+        // Probe from the first to the last domain at 1000 packets/s
+        uint16_t probePort = 5000;
+        OnOffHelper probe("ns3::UdpSocketFactory",
+                          InetSocketAddress(hostIpIfaces.GetAddress(nHosts - 1), probePort));
+        probe.SetConstantRate(DataRate("1Mbps"), 125);
+        ApplicationContainer probeApp = probe.Install(hosts.Get(0));
+        probeApp.Start(Seconds(exchangeStart + 1));
+        probeApp.Stop(Seconds(simTime));
+        PacketSinkHelper probeSink("ns3::UdpSocketFactory",
+                                   InetSocketAddress(Ipv4Address::GetAny(), probePort));
+        ApplicationContainer probeSinkApp = probeSink.Install(hosts.Get(nHosts - 1));
+        faultInjector->WatchTx(probeApp.Get(0));
+        faultInjector->WatchRx(DynamicCast<PacketSink>(probeSinkApp.Get(0)));
+    }
+
+    // Run the simulation, monitoring the hosts only
+    Simulator::Stop(Seconds(simTime));
+    FlowMonitorHelper flowmon;
+    Ptr<FlowMonitor> monitor = flowmon.Install(hosts);
+    Simulator::Run();
+
+    uint64_t txPackets = 0;
+    uint64_t rxPackets = 0;
+    for (const auto& entry : monitor->GetFlowStats())
+    {
+        txPackets += entry.second.txPackets;
+        rxPackets += entry.second.rxPackets;
+    }
+    NS_LOG_UNCOND("--------Total Results of the simulation----------" << std::endl);
+    NS_LOG_UNCOND("Total sent packets  =" << txPackets);
+    NS_LOG_UNCOND("Total Received Packets =" << rxPackets);
+    if (txPackets)
+    {
+        NS_LOG_UNCOND("Packet delivery ratio =" << rxPackets * 100.0 / txPackets << "%");
+    }
+
+    uint64_t updates = 0;
+    uint64_t bytes = 0;
+    uint64_t announced = 0;
+    uint64_t withdrawn = 0;
+    uint64_t changes = 0;
+    uint64_t reachable = 0;
+    uint32_t longest = 0;
+    Time lastChange;
+    for (const auto& ctrl : ctrls)
+    {
+        updates += ctrl->GetUpdatesSent();
+        bytes += ctrl->GetUpdateBytes();
+        announced += ctrl->GetRoutesAnnounced();
+        withdrawn += ctrl->GetRoutesWithdrawn();
+        changes += ctrl->GetRibChanges();
+        reachable += ctrl->GetReachable();
+        longest = std::max(longest, ctrl->GetLongestPath());
+        lastChange = Max(lastChange, ctrl->GetLastChange());
+    }
+    NS_LOG_UNCOND("--------Inter-domain exchange (" << nDomains << " domains, " << links.size()
+                  << " links)----------" << std::endl);
+    NS_LOG_UNCOND("Control-plane convergence =" << lastChange.GetSeconds() - exchangeStart
+                  << "s" << (faults.empty() ? "" : " (last change, faults included)"));
+    NS_LOG_UNCOND("Updates sent =" << updates << " bytes =" << bytes
+                  << " per domain =" << (double)updates / nDomains);
+    NS_LOG_UNCOND("Routes announced =" << announced << " withdrawn =" << withdrawn
+                  << " best route changes =" << changes);
+    NS_LOG_UNCOND("Reachable prefixes =" << reachable << " of " << nDomains * nDomains
+                  << " longest path =" << longest << " domains");
+    if (faultInjector)
+    {
+        faultInjector->Report();
+    }
+    Simulator::Destroy();
+}
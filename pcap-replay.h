@@ -0,0 +1,454 @@
+/*
+ * Pcap trace replay traffic source.
+ *
+ * Streams a classic pcap file (microsecond or nanosecond timestamps, either
+ * byte order; Ethernet, raw IPv4 or Linux cooked link types) through a
+ * read-only memory mapping and re-originates each IPv4 TCP/UDP packet as a
+ * UDP datagram of the same transport payload size, sent at the recorded time
+ * offset from the simulation host mapped to the captured source address.
+ *
+ * Only one record is decoded ahead of the simulation clock and the pages
+ * behind the read cursor are released as the replay advances, so memory use
+ * does not grow with the size of the capture.
+ */
+
+#ifndef PCAP_REPLAY_H
+#define PCAP_REPLAY_H
+
+#include <ns3/applications-module.h>
+#include <ns3/core-module.h>
+#include <ns3/internet-module.h>
+#include <ns3/network-module.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <map>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Sequential reader over a memory-mapped pcap file.
+ */
+class PcapTraceReader : public SimpleRefCount<PcapTraceReader>
+{
+  public:
+    /** The IPv4 view of one captured packet. */
+    struct Record
+    {
+        Time timestamp;   //!< Capture timestamp
+        Ipv4Address src;  //!< IPv4 source
+        Ipv4Address dst;  //!< IPv4 destination
+        uint8_t protocol; //!< IPv4 protocol number
+        uint32_t payload; //!< Transport payload bytes on the wire
+    };
+
+    /**
+     * Map the file and validate its global header.
+     * \param filename The pcap file.
+     */
+    explicit PcapTraceReader(std::string filename)
+    {
+        int fd = open(filename.c_str(), O_RDONLY);
+        NS_ABORT_MSG_IF(fd < 0, "Can't open pcap trace " << filename);
+        struct stat st;
+        NS_ABORT_MSG_IF(fstat(fd, &st) != 0 || st.st_size < 24, "Bad pcap trace " << filename);
+        m_size = st.st_size;
+        void* map = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        NS_ABORT_MSG_IF(map == MAP_FAILED, "Can't map pcap trace " << filename);
+        m_base = static_cast<const uint8_t*>(map);
+        madvise(const_cast<uint8_t*>(m_base), m_size, MADV_SEQUENTIAL);
+
+        uint32_t magic = Read32(0);
+        switch (magic)
+        {
+        case 0xa1b2c3d4:
+            break;
+        case 0xa1b23c4d:
+            m_nanosecond = true;
+            break;
+        case 0xd4c3b2a1:
+            m_swapped = true;
+            break;
+        case 0x4d3cb2a1:
+            m_swapped = true;
+            m_nanosecond = true;
+            break;
+        default:
+            NS_ABORT_MSG("Not a pcap trace (pcapng is not supported): " << filename);
+        }
+        m_linkType = Read32(20);
+        NS_ABORT_MSG_IF(m_linkType != LINKTYPE_ETHERNET && m_linkType != LINKTYPE_RAW &&
+                            m_linkType != LINKTYPE_LINUX_SLL,
+                        "Unsupported pcap link type " << m_linkType);
+        m_offset = 24;
+    }
+
+    ~PcapTraceReader()
+    {
+        munmap(const_cast<uint8_t*>(m_base), m_size);
+    }
+
+    /**
+     * Advance to the next IPv4 TCP or UDP packet.
+     * \param rec Filled with the packet on success.
+     * \return false at the end of the trace.
+     */
+    bool Next(Record& rec)
+    {
+        while (m_offset + 16 <= m_size)
+        {
+            uint64_t sec = Read32(m_offset);
+            uint64_t frac = Read32(m_offset + 4);
+            uint32_t capLen = Read32(m_offset + 8);
+            uint32_t origLen = Read32(m_offset + 12);
+            const uint8_t* data = m_base + m_offset + 16;
+            m_offset += 16 + capLen;
+            if (m_offset > m_size)
+            {
+                break;
+            }
+            ReleaseConsumed();
+            m_records++;
+
+            rec.timestamp = NanoSeconds(sec * 1000000000 + (m_nanosecond ? frac : frac * 1000));
+            if (Decode(data, capLen, origLen, rec))
+            {
+                return true;
+            }
+            m_skipped++;
+        }
+        return false;
+    }
+
+    /** \return the number of records read so far. */
+    uint64_t GetRecords() const
+    {
+        return m_records;
+    }
+
+    /** \return the number of records that were not IPv4 TCP/UDP. */
+    uint64_t GetSkipped() const
+    {
+        return m_skipped;
+    }
+
+  private:
+    static const uint32_t LINKTYPE_ETHERNET = 1;
+    static const uint32_t LINKTYPE_RAW = 101;
+    static const uint32_t LINKTYPE_LINUX_SLL = 113;
+
+    /** Pages behind the cursor are dropped in chunks of this size. */
+    static const uint64_t RELEASE_CHUNK = 64 << 20;
+
+    uint32_t Read32(uint64_t offset) const
+    {
+        uint32_t v;
+        std::memcpy(&v, m_base + offset, 4);
+        return m_swapped ? __builtin_bswap32(v) : v;
+    }
+
+    /** Let the kernel reclaim the mapped pages the replay has consumed. */
+    void ReleaseConsumed()
+    {
+        if (m_offset - m_released < 2 * RELEASE_CHUNK)
+        {
+            return;
+        }
+        madvise(const_cast<uint8_t*>(m_base) + m_released, RELEASE_CHUNK, MADV_DONTNEED);
+        m_released += RELEASE_CHUNK;
+    }
+
+    /** Extract the IPv4 fields of a frame. */
+    bool Decode(const uint8_t* data, uint32_t capLen, uint32_t origLen, Record& rec) const
+    {
+        uint32_t ip = 0;
+        uint16_t etherType = 0x0800;
+        if (m_linkType == LINKTYPE_ETHERNET)
+        {
+            ip = 14;
+            if (capLen < ip)
+            {
+                return false;
+            }
+            etherType = (data[12] << 8) | data[13];
+            if (etherType == 0x8100 && capLen >= 18)
+            {
+                etherType = (data[16] << 8) | data[17];
+                ip = 18;
+            }
+        }
+        else if (m_linkType == LINKTYPE_LINUX_SLL)
+        {
+            ip = 16;
+            if (capLen < ip)
+            {
+                return false;
+            }
+            etherType = (data[14] << 8) | data[15];
+        }
+        if (etherType != 0x0800 || capLen < ip + 20 || (data[ip] >> 4) != 4)
+        {
+            return false;
+        }
+
+        uint32_t ihl = (data[ip] & 0x0f) * 4;
+        uint32_t totalLen = (data[ip + 2] << 8) | data[ip + 3];
+        rec.protocol = data[ip + 9];
+        rec.src = Ipv4Address((data[ip + 12] << 24) | (data[ip + 13] << 16) |
+                              (data[ip + 14] << 8) | data[ip + 15]);
+        rec.dst = Ipv4Address((data[ip + 16] << 24) | (data[ip + 17] << 16) |
+                              (data[ip + 18] << 8) | data[ip + 19]);
+        if (totalLen == 0)
+        {
+            // TSO captures may leave the length field empty
+            totalLen = origLen - ip;
+        }
+
+        uint32_t l4 = ip + ihl;
+        uint32_t l4Header;
+        if (rec.protocol == 17)
+        {
+            l4Header = 8;
+        }
+        else if (rec.protocol == 6 && capLen >= l4 + 13)
+        {
+            l4Header = (data[l4 + 12] >> 4) * 4;
+        }
+        else
+        {
+            return false;
+        }
+        if (totalLen <= ihl + l4Header)
+        {
+            return false;
+        }
+        // Larger payloads only come from offloaded captures; cap at one datagram
+        rec.payload = std::min<uint32_t>(totalLen - ihl - l4Header, 65507);
+        return true;
+    }
+
+    const uint8_t* m_base{nullptr};
+    uint64_t m_size{0};
+    uint64_t m_offset{0};
+    uint64_t m_released{0};
+    uint32_t m_linkType{0};
+    bool m_swapped{false};
+    bool m_nanosecond{false};
+    uint64_t m_records{0};
+    uint64_t m_skipped{0};
+};
+
+/**
+ * Sends the datagrams of one replayed source host.
+ */
+class PcapReplayApplication : public Application
+{
+  public:
+    static TypeId GetTypeId()
+    {
+        static TypeId tid =
+            TypeId("ns3::PcapReplayApplication")
+                .SetParent<Application>()
+                .AddConstructor<PcapReplayApplication>()
+                .AddTraceSource("Tx",
+                                "A datagram was sent",
+                                MakeTraceSourceAccessor(&PcapReplayApplication::m_txTrace),
+                                "ns3::Packet::TracedCallback");
+        return tid;
+    }
+
+    /**
+     * Send one replayed datagram.
+     * \param dst The destination address.
+     * \param port The destination port.
+     * \param size The payload size.
+     */
+    void Inject(Ipv4Address dst, uint16_t port, uint32_t size)
+    {
+        if (!m_socket)
+        {
+            return;
+        }
+        Ptr<Packet> packet = Create<Packet>(size);
+        m_txTrace(packet);
+        m_socket->SendTo(packet, 0, InetSocketAddress(dst, port));
+    }
+
+  private:
+    void StartApplication() override
+    {
+        m_socket = Socket::CreateSocket(GetNode(), UdpSocketFactory::GetTypeId());
+        m_socket->Bind();
+    }
+
+    void StopApplication() override
+    {
+        if (m_socket)
+        {
+            m_socket->Close();
+            m_socket = nullptr;
+        }
+    }
+
+    Ptr<Socket> m_socket;
+    TracedCallback<Ptr<const Packet>> m_txTrace;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(PcapReplayApplication);
+
+/**
+ * Drives the replay: maps captured addresses to simulation hosts, installs
+ * the per-host senders and discard sinks, and schedules one record at a time.
+ */
+class PcapReplayHelper : public SimpleRefCount<PcapReplayHelper>
+{
+  public:
+    /**
+     * \param filename The pcap trace to replay.
+     * \param port UDP port the replayed datagrams are sent to.
+     */
+    PcapReplayHelper(std::string filename, uint16_t port = 9)
+        : m_reader(Create<PcapTraceReader>(filename)),
+          m_port(port)
+    {
+    }
+
+    /**
+     * Pin a captured address to a host. Unpinned addresses are assigned to
+     * the hosts round-robin in order of first appearance.
+     * \param captured The address seen in the trace.
+     * \param host Index of the host in the container given to Install ().
+     */
+    void Map(Ipv4Address captured, uint32_t host)
+    {
+        m_map[captured] = host;
+    }
+
+    /**
+     * Install the senders and sinks and schedule the first record.
+     * \param hosts The hosts that replay the trace.
+     * \param addresses The IPv4 address of each host.
+     * \param start Simulation time of the first record.
+     * \param stop No record is sent after this time.
+     */
+    void Install(NodeContainer hosts, Ipv4InterfaceContainer addresses, Time start, Time stop)
+    {
+        m_addresses = addresses;
+        m_start = start;
+        m_stop = stop;
+
+        PacketSinkHelper sink("ns3::UdpSocketFactory",
+                              InetSocketAddress(Ipv4Address::GetAny(), m_port));
+        ApplicationContainer sinks = sink.Install(hosts);
+        sinks.Start(Seconds(0));
+        for (uint32_t i = 0; i < hosts.GetN(); i++)
+        {
+            Ptr<PcapReplayApplication> app = CreateObject<PcapReplayApplication>();
+            hosts.Get(i)->AddApplication(app);
+            app->SetStartTime(Seconds(0));
+            app->SetStopTime(stop);
+            m_apps.push_back(app);
+        }
+        Simulator::Schedule(start, &PcapReplayHelper::ScheduleNext, this);
+    }
+
+    /** \return the number of datagrams injected. */
+    uint64_t GetSent() const
+    {
+        return m_sent;
+    }
+
+    /** \return the number of payload bytes injected. */
+    uint64_t GetSentBytes() const
+    {
+        return m_sentBytes;
+    }
+
+    /** \return the number of trace records not replayed. */
+    uint64_t GetSkipped() const
+    {
+        return m_reader->GetSkipped() + m_selfSent;
+    }
+
+  private:
+    /** \return the host index a captured address is replayed from/to. */
+    uint32_t HostOf(Ipv4Address captured)
+    {
+        auto it = m_map.find(captured);
+        if (it != m_map.end())
+        {
+            return it->second;
+        }
+        uint32_t host = m_nextHost++ % m_apps.size();
+        m_map[captured] = host;
+        return host;
+    }
+
+    /** Read the next replayable record and schedule it at its offset. */
+    void ScheduleNext()
+    {
+        PcapTraceReader::Record rec;
+        while (m_reader->Next(rec))
+        {
+            uint32_t src = HostOf(rec.src);
+            uint32_t dst = HostOf(rec.dst);
+            if (src == dst)
+            {
+                m_selfSent++;
+                continue;
+            }
+            if (!m_first)
+            {
+                m_first = true;
+                m_firstTimestamp = rec.timestamp;
+            }
+            Time at = m_start + (rec.timestamp - m_firstTimestamp);
+            if (at >= m_stop)
+            {
+                return;
+            }
+            Simulator::Schedule(Max(at - Simulator::Now(), Time(0)),
+                                &PcapReplayHelper::Send,
+                                this,
+                                src,
+                                dst,
+                                rec.payload);
+            return;
+        }
+    }
+
+    /** Send a scheduled record and fetch the following one. */
+    void Send(uint32_t src, uint32_t dst, uint32_t size)
+    {
+        m_apps[src]->Inject(m_addresses.GetAddress(dst), m_port, size);
+        m_sent++;
+        m_sentBytes += size;
+        ScheduleNext();
+    }
+
+    Ptr<PcapTraceReader> m_reader;
+    uint16_t m_port;
+    std::map<Ipv4Address, uint32_t> m_map;
+    uint32_t m_nextHost{0};
+    std::vector<Ptr<PcapReplayApplication>> m_apps;
+    Ipv4InterfaceContainer m_addresses;
+    Time m_start;
+    Time m_stop;
+    bool m_first{false};
+    Time m_firstTimestamp;
+    uint64_t m_sent{0};
+    uint64_t m_sentBytes{0};
+    uint64_t m_selfSent{0};
+};
+
+} // namespace ns3
+
+#endif /* PCAP_REPLAY_H */
@@ -0,0 +1,579 @@
+/*
+ * Merged pcapng capture sink for the OpenFlow scenarios.
+ *
+ * CsmaHelper::EnablePcap opens one pcap file per device and writes every
+ * frame synchronously from the event loop. This sink registers every selected
+ * device as an interface of a single pcapng section and hands the captured
+ * frames to a background writer thread through a single-producer /
+ * single-consumer ring, so the simulation thread only copies bytes.
+ *
+ * For large runs the sink can truncate frames to a snap length and keep only
+ * one in N packets, or one in N flows (hashed on the IPv4 5-tuple, so every
+ * packet of a kept flow is captured). Fragmented datagrams are kept or
+ * dropped whole: all their fragments hash on the addresses, protocol and
+ * IP identification.
+ *
+ * Usage:
+ *
+ *   Ptr<PcapngCaptureSink> capture = Create<PcapngCaptureSink>("capture.pcapng");
+ *   capture->SetSnapLen(128);
+ *   capture->SetSampling(PcapngCaptureSink::SAMPLE_FLOWS, 10);
+ *   capture->AddNodeDevices(controllers.Get(0), "openflow-0", true);
+ *   capture->AddDevices(switchPorts[0], "switch", true);
+ *   capture->AddDevices(hostDevices, "host", false);
+ *   Simulator::Run();
+ *   capture->Close();
+ */
+
+#ifndef PCAPNG_CAPTURE_H
+#define PCAPNG_CAPTURE_H
+
+#include <ns3/core-module.h>
+#include <ns3/network-module.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Fixed-size single-producer / single-consumer ring of capture records.
+ *
+ * The simulation thread is the only producer and the writer thread the only
+ * consumer, so head and tail only need acquire/release ordering. Each slot
+ * keeps its byte buffer across reuse, which makes steady-state capture
+ * allocation free.
+ */
+class CaptureRing
+{
+  public:
+    /** Record kinds carried through the ring. */
+    enum Kind
+    {
+        INTERFACE, //!< Interface description (name and link type)
+        FRAME      //!< Captured frame
+    };
+
+    /** One ring slot. */
+    struct Record
+    {
+        Kind kind{FRAME};
+        uint32_t ifIndex{0};
+        uint64_t timestampNs{0};
+        uint32_t origLen{0};
+        uint16_t linkType{0};
+        uint32_t snapLen{0};
+        std::string name;
+        std::vector<uint8_t> data;
+    };
+
+    /**
+     * \param slots Number of slots, rounded up to a power of two.
+     */
+    explicit CaptureRing(uint32_t slots)
+    {
+        uint32_t size = 1;
+        while (size < slots)
+        {
+            size <<= 1;
+        }
+        m_slots.resize(size);
+        m_mask = size - 1;
+    }
+
+    /** \return the next free slot, or nullptr if the ring is full. */
+    Record* Reserve()
+    {
+        uint32_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) > m_mask)
+        {
+            return nullptr;
+        }
+        return &m_slots[head & m_mask];
+    }
+
+    /** Publish the slot returned by the last Reserve (). */
+    void Commit()
+    {
+        m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /** \return the oldest published slot, or nullptr if the ring is empty. */
+    Record* Peek()
+    {
+        uint32_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_head.load(std::memory_order_acquire))
+        {
+            return nullptr;
+        }
+        return &m_slots[tail & m_mask];
+    }
+
+    /** Return the slot obtained by the last Peek () to the producer. */
+    void Release()
+    {
+        m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+  private:
+    std::vector<Record> m_slots;
+    uint32_t m_mask{0};
+    alignas(64) std::atomic<uint32_t> m_head{0}; //!< Next slot to publish
+    alignas(64) std::atomic<uint32_t> m_tail{0}; //!< Next slot to consume
+};
+
+/**
+ * Capture sink writing the frames of many devices into one pcapng file.
+ */
+class PcapngCaptureSink : public SimpleRefCount<PcapngCaptureSink>
+{
+  public:
+    /** pcapng link types used by the ns-3 devices in these scenarios. */
+    static const uint16_t LINKTYPE_ETHERNET = 1;
+    static const uint16_t LINKTYPE_PPP = 9;
+
+    /** Frame sampling policies. */
+    enum SamplingMode
+    {
+        SAMPLE_PACKETS, //!< Keep one in N frames of each interface
+        SAMPLE_FLOWS    //!< Keep the frames of one in N IPv4 flows
+    };
+
+    /**
+     * Open the output file and start the writer thread.
+     * \param filename Output pcapng file name.
+     * \param ringSlots Capacity of the hand-off ring, in frames.
+     */
+    PcapngCaptureSink(std::string filename, uint32_t ringSlots = 16384)
+        : m_ring(ringSlots)
+    {
+        m_file = std::fopen(filename.c_str(), "wb");
+        NS_ABORT_MSG_IF(!m_file, "Can't open capture file " << filename);
+        m_fileBuffer.resize(1 << 20);
+        std::setvbuf(m_file, m_fileBuffer.data(), _IOFBF, m_fileBuffer.size());
+        WriteSectionHeader();
+        m_writer = std::thread(&PcapngCaptureSink::WriterLoop, this);
+    }
+
+    ~PcapngCaptureSink()
+    {
+        Close();
+    }
+
+    /**
+     * When the ring is full, either drop the frame and count it (the default,
+     * so the simulation never waits on the disk) or wait for the writer.
+     * \param block True to wait for a free slot instead of dropping.
+     */
+    void SetBlockWhenFull(bool block)
+    {
+        m_blockWhenFull = block;
+    }
+
+    /**
+     * Truncate captured frames. Affects interfaces added afterwards.
+     * \param snapLen Maximum bytes stored per frame, 0 for no limit.
+     */
+    void SetSnapLen(uint32_t snapLen)
+    {
+        m_snapLen = snapLen;
+    }
+
+    /**
+     * Capture only a sample of the frames. Frames that are not IPv4 (ARP,
+     * for instance) are always kept in flow mode.
+     * \param mode Whether to sample individual frames or whole flows.
+     * \param rate Keep one in rate frames or flows; 1 keeps everything.
+     */
+    void SetSampling(SamplingMode mode, uint32_t rate)
+    {
+        NS_ABORT_MSG_IF(rate == 0, "Sampling rate must be at least 1");
+        m_samplingMode = mode;
+        m_samplingRate = rate;
+    }
+
+    /**
+     * Register a device as a pcapng interface and hook its sniffer trace.
+     * \param device The device to capture.
+     * \param name The interface name recorded in the file.
+     * \param promiscuous Capture all frames seen on the channel.
+     * \return The pcapng interface ID assigned to the device.
+     */
+    uint32_t AddDevice(Ptr<NetDevice> device, std::string name, bool promiscuous)
+    {
+        NS_ABORT_MSG_IF(m_closed, "Capture sink already closed");
+        uint32_t ifIndex = m_interfaces.size();
+        m_interfaces.push_back({GetLinkType(device), m_snapLen, 0});
+
+        CaptureRing::Record* rec = AcquireSlot(true);
+        rec->kind = CaptureRing::INTERFACE;
+        rec->ifIndex = ifIndex;
+        rec->linkType = m_interfaces.back().linkType;
+        rec->snapLen = m_snapLen;
+        rec->name = name;
+        m_ring.Commit();
+
+        device->TraceConnectWithoutContext(
+            promiscuous ? "PromiscSniffer" : "Sniffer",
+            MakeBoundCallback(&PcapngCaptureSink::CaptureFrame, this, ifIndex));
+        return ifIndex;
+    }
+
+    /**
+     * Register all devices in the container, naming each interface after
+     * prefix, node and device index as CsmaHelper::EnablePcap does.
+     * \param devices The devices to capture.
+     * \param prefix The interface name prefix.
+     * \param promiscuous Capture all frames seen on the channel.
+     */
+    void AddDevices(NetDeviceContainer devices, std::string prefix, bool promiscuous)
+    {
+        for (auto it = devices.Begin(); it != devices.End(); ++it)
+        {
+            std::ostringstream name;
+            name << prefix << "-" << (*it)->GetNode()->GetId() << "-" << (*it)->GetIfIndex();
+            AddDevice(*it, name.str(), promiscuous);
+        }
+    }
+
+    /**
+     * Register all devices of a node except the loopback. On a controller
+     * node these are the OpenFlow channel devices, which replaces
+     * OFSwitch13Helper::EnableOpenFlowPcap.
+     * \param node The node.
+     * \param prefix The interface name prefix.
+     * \param promiscuous Capture all frames seen on the channel.
+     */
+    void AddNodeDevices(Ptr<Node> node, std::string prefix, bool promiscuous)
+    {
+        NetDeviceContainer devices;
+        for (uint32_t i = 0; i < node->GetNDevices(); i++)
+        {
+            Ptr<NetDevice> device = node->GetDevice(i);
+            if (device->GetInstanceTypeId().GetName() != "ns3::LoopbackNetDevice")
+            {
+                devices.Add(device);
+            }
+        }
+        AddDevices(devices, prefix, promiscuous);
+    }
+
+    /**
+     * Drain the ring, stop the writer thread and close the file.
+     * Safe to call more than once.
+     */
+    void Close()
+    {
+        if (m_closed)
+        {
+            return;
+        }
+        m_closed = true;
+        m_stop.store(true, std::memory_order_release);
+        m_writer.join();
+        std::fclose(m_file);
+        m_file = nullptr;
+    }
+
+    /** \return the number of frames handed to the writer thread. */
+    uint64_t GetCapturedFrames() const
+    {
+        return m_captured;
+    }
+
+    /** \return the number of frames dropped because the ring was full. */
+    uint64_t GetDroppedFrames() const
+    {
+        return m_dropped;
+    }
+
+    /** \return the number of frames skipped by the sampling policy. */
+    uint64_t GetSampledOutFrames() const
+    {
+        return m_sampledOut;
+    }
+
+    /** \return the number of frame bytes handed to the writer thread. */
+    uint64_t GetCapturedBytes() const
+    {
+        return m_capturedBytes;
+    }
+
+  private:
+    /**
+     * Sniffer trace sink. Runs in the simulation thread.
+     * \param sink The capture sink.
+     * \param ifIndex The pcapng interface ID of the device.
+     * \param packet The captured frame.
+     */
+    static void CaptureFrame(PcapngCaptureSink* sink, uint32_t ifIndex, Ptr<const Packet> packet)
+    {
+        Interface& iface = sink->m_interfaces[ifIndex];
+        if (!sink->IsSampled(iface, packet))
+        {
+            sink->m_sampledOut++;
+            return;
+        }
+        CaptureRing::Record* rec = sink->AcquireSlot(sink->m_blockWhenFull);
+        if (!rec)
+        {
+            sink->m_dropped++;
+            return;
+        }
+        uint32_t size = packet->GetSize();
+        uint32_t capLen = (iface.snapLen && iface.snapLen < size) ? iface.snapLen : size;
+        rec->kind = CaptureRing::FRAME;
+        rec->ifIndex = ifIndex;
+        rec->timestampNs = Simulator::Now().GetNanoSeconds();
+        rec->origLen = size;
+        rec->data.resize(capLen);
+        packet->CopyData(rec->data.data(), capLen);
+        sink->m_ring.Commit();
+        sink->m_captured++;
+        sink->m_capturedBytes += capLen;
+    }
+
+    /** Per-interface state kept by the simulation thread. */
+    struct Interface
+    {
+        uint16_t linkType;
+        uint32_t snapLen;
+        uint32_t seen; //!< Frames seen, for packet sampling
+    };
+
+    /**
+     * Apply the sampling policy.
+     * \param iface The interface the frame was seen on.
+     * \param packet The frame.
+     * \return true if the frame should be captured.
+     */
+    bool IsSampled(Interface& iface, Ptr<const Packet> packet)
+    {
+        if (m_samplingRate == 1)
+        {
+            return true;
+        }
+        if (m_samplingMode == SAMPLE_PACKETS)
+        {
+            return (iface.seen++ % m_samplingRate) == 0;
+        }
+
+        // Flow sampling: hash the IPv4 5-tuple straight from the frame bytes.
+        uint8_t hdr[64];
+        uint32_t len = packet->CopyData(hdr, sizeof(hdr));
+        uint32_t ip = 0;
+        if (iface.linkType == LINKTYPE_PPP)
+        {
+            if (len < 2 || hdr[0] != 0x00 || hdr[1] != 0x21)
+            {
+                return true;
+            }
+            ip = 2;
+        }
+        else
+        {
+            uint32_t typeOffset = 12;
+            if (len >= 16 && hdr[12] == 0x81 && hdr[13] == 0x00)
+            {
+                typeOffset = 16;
+            }
+            if (len < typeOffset + 2 || hdr[typeOffset] != 0x08 || hdr[typeOffset + 1] != 0x00)
+            {
+                return true;
+            }
+            ip = typeOffset + 2;
+        }
+        if (len < ip + 20)
+        {
+            return true;
+        }
+        uint32_t ihl = (hdr[ip] & 0x0f) * 4;
+        uint8_t proto = hdr[ip + 9];
+        bool fragment = (hdr[ip + 6] & 0x3f) | hdr[ip + 7]; // MF flag or offset
+
+        // FNV-1a over protocol, addresses and either the L4 ports or, for
+        // every fragment of a fragmented datagram, the IP identification:
+        // only the first fragment carries the ports, and the same decision
+        // must hold for all of them.
+        uint32_t hash = 2166136261u;
+        auto mix = [&hash](const uint8_t* bytes, uint32_t n) {
+            for (uint32_t i = 0; i < n; i++)
+            {
+                hash = (hash ^ bytes[i]) * 16777619u;
+            }
+        };
+        mix(&proto, 1);
+        mix(hdr + ip + 12, 8);
+        if (fragment)
+        {
+            mix(hdr + ip + 4, 2);
+        }
+        else if ((proto == 6 || proto == 17) && len >= ip + ihl + 4)
+        {
+            mix(hdr + ip + ihl, 4);
+        }
+        return (hash % m_samplingRate) == 0;
+    }
+
+    /**
+     * \param wait Spin until a slot is free instead of failing.
+     * \return a free ring slot, or nullptr if full and not waiting.
+     */
+    CaptureRing::Record* AcquireSlot(bool wait)
+    {
+        CaptureRing::Record* rec = m_ring.Reserve();
+        while (!rec && wait)
+        {
+            std::this_thread::yield();
+            rec = m_ring.Reserve();
+        }
+        return rec;
+    }
+
+    /**
+     * \param device The device.
+     * \return the pcapng link type of the frames its sniffers deliver.
+     */
+    static uint16_t GetLinkType(Ptr<NetDevice> device)
+    {
+        if (device->GetInstanceTypeId().GetName() == "ns3::PointToPointNetDevice")
+        {
+            return LINKTYPE_PPP;
+        }
+        return LINKTYPE_ETHERNET;
+    }
+
+    /** Writer thread body: consume the ring until closed and drained. */
+    void WriterLoop()
+    {
+        while (true)
+        {
+            CaptureRing::Record* rec = m_ring.Peek();
+            if (!rec)
+            {
+                if (m_stop.load(std::memory_order_acquire) && !m_ring.Peek())
+                {
+                    break;
+                }
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+                continue;
+            }
+            if (rec->kind == CaptureRing::INTERFACE)
+            {
+                WriteInterfaceDescription(rec->linkType, rec->snapLen, rec->name);
+            }
+            else
+            {
+                WriteEnhancedPacket(*rec);
+            }
+            m_ring.Release();
+        }
+        std::fflush(m_file);
+    }
+
+    /** Append raw bytes to the output file. */
+    void Put(const void* data, size_t len)
+    {
+        std::fwrite(data, 1, len, m_file);
+    }
+
+    void Put32(uint32_t value)
+    {
+        Put(&value, 4);
+    }
+
+    void Put16(uint16_t value)
+    {
+        Put(&value, 2);
+    }
+
+    /** Write zero padding up to the next 32-bit boundary. */
+    void Pad(size_t len)
+    {
+        static const uint8_t zeros[4] = {0, 0, 0, 0};
+        Put(zeros, (4 - (len % 4)) % 4);
+    }
+
+    static uint32_t Padded(size_t len)
+    {
+        return (len + 3) & ~3U;
+    }
+
+    /** Section Header Block, host byte order, unknown section length. */
+    void WriteSectionHeader()
+    {
+        Put32(0x0A0D0D0A);
+        Put32(28);
+        Put32(0x1A2B3C4D);
+        Put16(1);
+        Put16(0);
+        Put32(0xFFFFFFFF);
+        Put32(0xFFFFFFFF);
+        Put32(28);
+    }
+
+    /** Interface Description Block with if_name and nanosecond if_tsresol. */
+    void WriteInterfaceDescription(uint16_t linkType, uint32_t snapLen, const std::string& name)
+    {
+        uint32_t options = 4 + Padded(name.size()) + 4 + 4 + 4;
+        uint32_t total = 20 + options;
+        Put32(0x00000001);
+        Put32(total);
+        Put16(linkType);
+        Put16(0);
+        Put32(snapLen);
+        Put16(2); // if_name
+        Put16(name.size());
+        Put(name.data(), name.size());
+        Pad(name.size());
+        Put16(9); // if_tsresol: 10^-9 s
+        Put16(1);
+        Put32(9);
+        Put32(0); // opt_endofopt
+        Put32(total);
+    }
+
+    /** Enhanced Packet Block. */
+    void WriteEnhancedPacket(const CaptureRing::Record& rec)
+    {
+        uint32_t capLen = rec.data.size();
+        uint32_t total = 32 + Padded(capLen);
+        Put32(0x00000006);
+        Put32(total);
+        Put32(rec.ifIndex);
+        Put32(static_cast<uint32_t>(rec.timestampNs >> 32));
+        Put32(static_cast<uint32_t>(rec.timestampNs));
+        Put32(capLen);
+        Put32(rec.origLen);
+        Put(rec.data.data(), capLen);
+        Pad(capLen);
+        Put32(total);
+    }
+
+    CaptureRing m_ring;
+    std::FILE* m_file{nullptr};
+    std::vector<char> m_fileBuffer;
+    std::thread m_writer;
+    std::atomic<bool> m_stop{false};
+    bool m_closed{false};
+    bool m_blockWhenFull{false};
+    std::vector<Interface> m_interfaces;
+    uint32_t m_snapLen{0};
+    SamplingMode m_samplingMode{SAMPLE_PACKETS};
+    uint32_t m_samplingRate{1};
+    uint64_t m_captured{0};
+    uint64_t m_capturedBytes{0};
+    uint64_t m_dropped{0};
+    uint64_t m_sampledOut{0};
+};
+
+} // namespace ns3
+
+#endif /* PCAPNG_CAPTURE_H */
@@ -0,0 +1,169 @@
+/*
+ * Per-port queue occupancy and drop counters for OpenFlow switches.
+ *
+ * A cheap alternative to LOG_LEVEL_ALL on OFSwitch13Queue: the monitor only
+ * hooks each port queue's PacketsInQueue/BytesInQueue traces to keep the
+ * maximum depth, samples queue lengths at a fixed period and reads the
+ * queue's own enqueue and drop counters at the end. Results are written as
+ * CSV: one depth sample per line, and one summary line per queue.
+ */
+
+#ifndef QUEUE_MONITOR_H
+#define QUEUE_MONITOR_H
+
+#include <ns3/core-module.h>
+#include <ns3/network-module.h>
+#include <ns3/ofswitch13-module.h>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Counts and samples the port queues of OpenFlow switches.
+ */
+class QueueMonitor : public SimpleRefCount<QueueMonitor>
+{
+  public:
+    QueueMonitor()
+    {
+    }
+
+    ~QueueMonitor()
+    {
+        Simulator::Cancel(m_sampleEvent);
+    }
+
+    /**
+     * Monitor all port queues of a switch, named <name>p<port>.
+     * \param device The OpenFlow switch device.
+     * \param name The switch name used in the output.
+     */
+    void AddSwitch(Ptr<OFSwitch13Device> device, std::string name)
+    {
+        for (uint32_t no = 1; no <= device->GetNSwitchPorts(); no++)
+        {
+            std::ostringstream queueName;
+            queueName << name << "p" << no;
+            Ptr<OFSwitch13Queue> queue = device->GetSwitchPort(no)->GetPortQueue();
+            uint32_t idx = m_queues.size();
+            m_queues.push_back({queueName.str(), queue, 0, 0});
+            queue->TraceConnectWithoutContext(
+                "PacketsInQueue",
+                MakeBoundCallback(&QueueMonitor::PacketsChanged, this, idx));
+            queue->TraceConnectWithoutContext(
+                "BytesInQueue",
+                MakeBoundCallback(&QueueMonitor::BytesChanged, this, idx));
+        }
+    }
+
+    /**
+     * Write the depth of every non-empty queue at a fixed period.
+     * \param interval The sampling period.
+     * \param filename The CSV file (time_s,queue,packets,bytes).
+     */
+    void StartSampling(Time interval, std::string filename)
+    {
+        m_interval = interval;
+        m_samples.open(filename);
+        m_samples << "time_s,queue,packets,bytes\n";
+        m_sampleEvent = Simulator::Schedule(interval, &QueueMonitor::Sample, this);
+    }
+
+    /**
+     * Write one line per queue with its totals and maximum depth.
+     * \param filename The CSV file.
+     */
+    void WriteSummary(std::string filename) const
+    {
+        std::ofstream out(filename);
+        out << "queue,enqueued,dequeued,dropped,max_packets,max_bytes\n";
+        for (const auto& q : m_queues)
+        {
+            out << q.name << "," << q.queue->GetTotalReceivedPackets() << ","
+                << q.queue->GetTotalReceivedPackets() - q.queue->GetNPackets() << ","
+                << q.queue->GetTotalDroppedPackets() << "," << q.maxPackets << "," << q.maxBytes
+                << "\n";
+        }
+    }
+
+    /**
+     * Print the queue with the most drops (or the deepest one, when nothing
+     * was dropped): the bottleneck of the run.
+     */
+    void Report() const
+    {
+        const Monitored* worst = nullptr;
+        for (const auto& q : m_queues)
+        {
+            uint32_t drops = q.queue->GetTotalDroppedPackets();
+            if (!worst || drops > worst->queue->GetTotalDroppedPackets() ||
+                (drops == worst->queue->GetTotalDroppedPackets() && q.maxPackets > worst->maxPackets))
+            {
+                worst = &q;
+            }
+        }
+        if (worst)
+        {
+            NS_LOG_UNCOND("Bottleneck queue " << worst->name
+                                              << " dropped =" << worst->queue->GetTotalDroppedPackets()
+                                              << " max depth =" << worst->maxPackets << " packets");
+        }
+    }
+
+  private:
+    /** One monitored queue. */
+    struct Monitored
+    {
+        std::string name;
+        Ptr<OFSwitch13Queue> queue;
+        uint32_t maxPackets;
+        uint32_t maxBytes;
+    };
+
+    static void PacketsChanged(QueueMonitor* monitor,
+                               uint32_t idx,
+                               uint32_t oldValue,
+                               uint32_t newValue)
+    {
+        Monitored& q = monitor->m_queues[idx];
+        q.maxPackets = std::max(q.maxPackets, newValue);
+    }
+
+    static void BytesChanged(QueueMonitor* monitor,
+                             uint32_t idx,
+                             uint32_t oldValue,
+                             uint32_t newValue)
+    {
+        Monitored& q = monitor->m_queues[idx];
+        q.maxBytes = std::max(q.maxBytes, newValue);
+    }
+
+    void Sample()
+    {
+        double now = Simulator::Now().GetSeconds();
+        for (const auto& q : m_queues)
+        {
+            if (q.queue->GetNPackets())
+            {
+                m_samples << now << "," << q.name << "," << q.queue->GetNPackets() << ","
+                          << q.queue->GetNBytes() << "\n";
+            }
+        }
+        m_sampleEvent = Simulator::Schedule(m_interval, &QueueMonitor::Sample, this);
+    }
+
+    std::vector<Monitored> m_queues;
+    Time m_interval;
+    EventId m_sampleEvent;
+    std::ofstream m_samples;
+};
+
+} // namespace ns3
+
+#endif /* QUEUE_MONITOR_H */
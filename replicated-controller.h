@@ -0,0 +1,638 @@
+/*
+ * Replicated controller cluster with a Raft-style log.
+ *
+ * The controller the switches talk to is the cluster leader; the other
+ * cluster members run a RaftFollower on their own nodes, reached over UDP
+ * on a simulated management network. Every change to the controller state
+ * is appended to the leader's log and replicated with AppendEntries
+ * messages: a new host location learned from a packet-in, and the removal
+ * of a learned entry. A packet-in that teaches a new location is held
+ * until its log entry is committed (persisted by a majority of the
+ * cluster), and only then learned, installed and forwarded, so flow setup
+ * pays the consensus round trip. Packet-ins that change nothing go through
+ * at once.
+ *
+ * Log persistence takes a fixed time per write and batches everything
+ * appended while the previous write was in flight (group commit). The
+ * leader keeps one AppendEntries in flight per follower, with up to
+ * maxBatch entries, which together with the persistence time bounds the
+ * commit throughput. Lost messages are resent on the heartbeat timer.
+ *
+ * The leader is fixed for the run (term 1): there are no elections, and
+ * followers keep the entry terms only, not their contents.
+ */
+
+#ifndef REPLICATED_CONTROLLER_H
+#define REPLICATED_CONTROLLER_H
+
+#include "domain-controller.h"
+
+#include <ns3/core-module.h>
+#include <ns3/internet-module.h>
+#include <ns3/network-module.h>
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <utility>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * AppendEntries request or reply. Entries follow the header as opaque
+ * payload of a fixed size each.
+ */
+class RaftHeader : public Header
+{
+  public:
+    /** Message types. */
+    enum Type : uint8_t
+    {
+        APPEND_ENTRIES = 0,
+        APPEND_REPLY = 1
+    };
+
+    uint8_t type{APPEND_ENTRIES};
+    uint64_t term{0};
+    uint64_t prevIndex{0}; //!< Index of the entry before the new ones
+    uint64_t prevTerm{0};  //!< Term of that entry
+    uint64_t index{0};     //!< Leader commit index, or follower match index
+    uint32_t entries{0};   //!< Entries carried
+    uint8_t success{0};    //!< Reply: the log matched
+
+    static TypeId GetTypeId()
+    {
+        static TypeId tid =
+            TypeId("ns3::RaftHeader").SetParent<Header>().AddConstructor<RaftHeader>();
+        return tid;
+    }
+
+    TypeId GetInstanceTypeId() const override
+    {
+        return GetTypeId();
+    }
+
+    uint32_t GetSerializedSize() const override
+    {
+        return 1 + 4 * 8 + 4 + 1;
+    }
+
+    void Serialize(Buffer::Iterator start) const override
+    {
+        start.WriteU8(type);
+        start.WriteHtonU64(term);
+        start.WriteHtonU64(prevIndex);
+        start.WriteHtonU64(prevTerm);
+        start.WriteHtonU64(index);
+        start.WriteHtonU32(entries);
+        start.WriteU8(success);
+    }
+
+    uint32_t Deserialize(Buffer::Iterator start) override
+    {
+        type = start.ReadU8();
+        term = start.ReadNtohU64();
+        prevIndex = start.ReadNtohU64();
+        prevTerm = start.ReadNtohU64();
+        index = start.ReadNtohU64();
+        entries = start.ReadNtohU32();
+        success = start.ReadU8();
+        return GetSerializedSize();
+    }
+
+    void Print(std::ostream& os) const override
+    {
+        os << (type == APPEND_ENTRIES ? "AppendEntries" : "AppendReply") << " term=" << term
+           << " prev=" << prevIndex << "/" << prevTerm << " index=" << index
+           << " entries=" << entries << " success=" << (uint32_t)success;
+    }
+};
+
+/**
+ * Cluster member that stores the leader's log and acknowledges it once
+ * persisted.
+ */
+class RaftFollower : public Application
+{
+  public:
+    static TypeId GetTypeId()
+    {
+        static TypeId tid = TypeId("ns3::RaftFollower")
+                                .SetParent<Application>()
+                                .AddConstructor<RaftFollower>()
+                                .AddAttribute("Port",
+                                              "Port on which AppendEntries are received",
+                                              UintegerValue(6700),
+                                              MakeUintegerAccessor(&RaftFollower::m_port),
+                                              MakeUintegerChecker<uint16_t>())
+                                .AddAttribute("PersistDelay",
+                                              "Time to write appended entries to stable storage",
+                                              TimeValue(MilliSeconds(1)),
+                                              MakeTimeAccessor(&RaftFollower::m_persistDelay),
+                                              MakeTimeChecker());
+        return tid;
+    }
+
+  private:
+    void StartApplication() override
+    {
+        m_socket = Socket::CreateSocket(GetNode(), UdpSocketFactory::GetTypeId());
+        m_socket->Bind(InetSocketAddress(Ipv4Address::GetAny(), m_port));
+        m_socket->SetRecvCallback(MakeCallback(&RaftFollower::HandleRead, this));
+    }
+
+    void StopApplication() override
+    {
+        if (m_socket)
+        {
+            m_socket->Close();
+            m_socket->SetRecvCallback(MakeNullCallback<void, Ptr<Socket>>());
+            m_socket = nullptr;
+        }
+    }
+
+    void HandleRead(Ptr<Socket> socket)
+    {
+        Ptr<Packet> packet;
+        Address from;
+        while ((packet = socket->RecvFrom(from)))
+        {
+            RaftHeader request;
+            packet->RemoveHeader(request);
+            if (request.type != RaftHeader::APPEND_ENTRIES)
+            {
+                continue;
+            }
+            RaftHeader reply;
+            reply.type = RaftHeader::APPEND_REPLY;
+            m_term = std::max(m_term, request.term);
+            reply.term = m_term;
+            bool matches = request.term == m_term && request.prevIndex <= m_terms.size() &&
+                           (!request.prevIndex || m_terms[request.prevIndex - 1] == request.prevTerm);
+            if (matches)
+            {
+                m_terms.resize(request.prevIndex);
+                m_terms.insert(m_terms.end(), request.entries, request.term);
+                reply.success = 1;
+            }
+            reply.index = m_terms.size();
+
+            // Acknowledge new entries only once they are on stable storage
+            Time wait(0);
+            if (matches && request.entries)
+            {
+                Time done = Max(Simulator::Now(), m_persistDone) + m_persistDelay;
+                m_persistDone = done;
+                wait = done - Simulator::Now();
+            }
+            Simulator::Schedule(wait, &RaftFollower::Reply, this, reply, from);
+        }
+    }
+
+    void Reply(RaftHeader reply, Address to)
+    {
+        if (m_socket)
+        {
+            Ptr<Packet> packet = Create<Packet>();
+            packet->AddHeader(reply);
+            m_socket->SendTo(packet, 0, to);
+        }
+    }
+
+    uint16_t m_port;
+    Time m_persistDelay;
+    Ptr<Socket> m_socket;
+    uint64_t m_term{0};
+    std::vector<uint64_t> m_terms; //!< Term of each log entry
+    Time m_persistDone;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(RaftFollower);
+
+/**
+ * Domain controller leading a replicated cluster: state changes are
+ * committed through the log before they take effect.
+ */
+class ReplicatedController : public DomainController
+{
+  public:
+    ReplicatedController()
+        : m_port(6700),
+          m_persistDelay(MilliSeconds(1)),
+          m_heartbeatInterval(MilliSeconds(50)),
+          m_maxBatch(256),
+          m_entrySize(64)
+    {
+    }
+
+    static TypeId GetTypeId()
+    {
+        static TypeId tid = TypeId("ns3::ReplicatedController")
+                                .SetParent<DomainController>()
+                                .AddConstructor<ReplicatedController>();
+        return tid;
+    }
+
+    void DoDispose() override
+    {
+        Simulator::Cancel(m_heartbeatEvent);
+        Simulator::Cancel(m_loadEvent);
+        for (auto& entry : m_log)
+        {
+            for (auto& held : entry.held)
+            {
+                ofl_msg_free((struct ofl_msg_header*)held.msg, nullptr);
+            }
+        }
+        m_log.clear();
+        m_followers.clear();
+        m_socket = nullptr;
+        DomainController::DoDispose();
+    }
+
+    /**
+     * \param persistDelay Time to write appended entries to stable storage.
+     * \param heartbeat Heartbeat and retransmission period.
+     * \param maxBatch Most entries in one AppendEntries.
+     * \param entrySize Bytes of one entry on the wire.
+     */
+    void SetReplication(Time persistDelay, Time heartbeat, uint32_t maxBatch, uint32_t entrySize)
+    {
+        NS_ABORT_MSG_IF((uint64_t)maxBatch * entrySize > 60000,
+                        "AppendEntries must fit in one UDP datagram");
+        m_persistDelay = persistDelay;
+        m_heartbeatInterval = heartbeat;
+        m_maxBatch = maxBatch;
+        m_entrySize = entrySize;
+    }
+
+    /**
+     * Add a cluster member running a RaftFollower.
+     * \param address Its address on the management network.
+     */
+    void AddFollower(Ipv4Address address)
+    {
+        Follower f;
+        f.address = InetSocketAddress(address, m_port);
+        m_followers.push_back(f);
+    }
+
+    /**
+     * Open the replication socket and start the heartbeats. The controller
+     * node must have its management network address.
+     */
+    void StartReplication()
+    {
+        m_socket = Socket::CreateSocket(GetNode(), UdpSocketFactory::GetTypeId());
+        m_socket->Bind();
+        m_socket->SetRecvCallback(MakeCallback(&ReplicatedController::HandleReply, this));
+        m_heartbeatEvent =
+            Simulator::Schedule(m_heartbeatInterval, &ReplicatedController::Heartbeat, this);
+    }
+
+    /**
+     * Append state changes not tied to a packet-in (e.g. changes made by
+     * other applications), as a Poisson process.
+     * \param rate Mean changes per second.
+     */
+    void StartStateLoad(double rate)
+    {
+        m_loadGap = CreateObject<ExponentialRandomVariable>();
+        m_loadGap->SetAttribute("Mean", DoubleValue(1.0 / rate));
+        m_loadEvent = Simulator::Schedule(Seconds(m_loadGap->GetValue()),
+                                          &ReplicatedController::SyntheticChange,
+                                          this);
+    }
+
+    /**
+     * Print the log, commit latency and throughput, and flow setup delay
+     * added by replication.
+     */
+    void ReportReplication()
+    {
+        NS_LOG_UNCOND("--------Controller cluster (" << m_followers.size() + 1
+                      << " nodes)----------" << std::endl);
+        NS_LOG_UNCOND("Log entries appended =" << m_log.size() << " committed =" << m_commitIndex);
+        NS_LOG_UNCOND("Commit latency mean =" << Mean(m_commitNs) / 1e6 << "ms"
+                      << " p99 =" << Percentile(m_commitNs, 0.99) / 1e6 << "ms");
+        NS_LOG_UNCOND("Held packet-ins =" << m_heldNs.size()
+                      << " added setup latency mean =" << Mean(m_heldNs) / 1e6 << "ms"
+                      << " p99 =" << Percentile(m_heldNs, 0.99) / 1e6 << "ms");
+        uint64_t peak = 0;
+        for (const auto& window : m_commitWindows)
+        {
+            peak = std::max(peak, window.second);
+        }
+        double span = (m_lastCommit - m_firstAppend).GetSeconds();
+        NS_LOG_UNCOND("Commit throughput mean =" << (span > 0 ? m_commitIndex / span : 0)
+                      << " entries/s peak =" << peak * 10 << " entries/s (100 ms windows)");
+        NS_LOG_UNCOND("AppendEntries sent =" << m_appendsSent << " bytes =" << m_appendBytes
+                      << " retransmissions =" << m_retransmissions);
+    }
+
+  protected:
+    /** A packet-in waiting for its log entry to commit. */
+    struct HeldPacketIn
+    {
+        struct ofl_msg_packet_in* msg;
+        Ptr<const RemoteSwitch> swtch;
+        uint32_t xid;
+        Time arrival;
+    };
+
+    /** One log entry. */
+    struct LogEntry
+    {
+        uint64_t term;
+        Time appended;
+        std::pair<uint64_t, Mac48Address> location; //!< Learned host, if any
+        std::vector<HeldPacketIn> held;
+    };
+
+    /** Leader view of one follower. */
+    struct Follower
+    {
+        Address address;
+        uint64_t nextIndex{1};
+        uint64_t matchIndex{0};
+        bool inflight{false};
+        Time sentAt;
+    };
+
+    ofl_err HandlePacketIn(struct ofl_msg_packet_in* msg,
+                           Ptr<const RemoteSwitch> swtch,
+                           uint32_t xid) override
+    {
+        uint64_t dpId = swtch->GetDpId();
+        if (msg->reason != OFPR_NO_MATCH || !m_alive || GetRole(dpId) == SLAVE)
+        {
+            return DomainController::HandlePacketIn(msg, swtch, xid);
+        }
+        struct ofl_match_tlv* input =
+            oxm_match_lookup(OXM_OF_IN_PORT, (struct ofl_match*)msg->match);
+        uint32_t inPort;
+        memcpy(&inPort, input->value, OXM_LENGTH(OXM_OF_IN_PORT));
+        struct ofl_match_tlv* ethSrc =
+            oxm_match_lookup(OXM_OF_ETH_SRC, (struct ofl_match*)msg->match);
+        Mac48Address src48;
+        src48.CopyFrom(ethSrc->value);
+
+        SwitchInfo& sw = m_switches[dpId];
+        std::pair<uint64_t, Mac48Address> location(dpId, src48);
+        auto pending = m_pending.find(location);
+        if (pending != m_pending.end())
+        {
+            // Same host as an uncommitted entry: wait for it too.
+            m_log[pending->second - 1].held.push_back({msg, swtch, xid, Simulator::Now()});
+            return 0;
+        }
+        if (sw.ports[inPort].blocked || sw.l2.find(src48) != sw.l2.end())
+        {
+            return DomainController::HandlePacketIn(msg, swtch, xid);
+        }
+        uint64_t index = Append(location);
+        m_pending[location] = index;
+        m_log[index - 1].held.push_back({msg, swtch, xid, Simulator::Now()});
+        return 0;
+    }
+
+    ofl_err HandleFlowRemoved(struct ofl_msg_flow_removed* msg,
+                              Ptr<const RemoteSwitch> swtch,
+                              uint32_t xid) override
+    {
+        // Forgetting a host is a state change too, but nothing waits on it.
+        if (m_alive)
+        {
+            Append({0, Mac48Address()});
+        }
+        return DomainController::HandleFlowRemoved(msg, swtch, xid);
+    }
+
+    /**
+     * Append an entry, start persisting it and replicate it.
+     * \return its log index.
+     */
+    uint64_t Append(std::pair<uint64_t, Mac48Address> location)
+    {
+        if (m_log.empty())
+        {
+            m_firstAppend = Simulator::Now();
+        }
+        m_log.push_back({m_term, Simulator::Now(), location, {}});
+        if (!m_persisting)
+        {
+            Persist();
+        }
+        for (uint32_t i = 0; i < m_followers.size(); i++)
+        {
+            SendAppend(i, false);
+        }
+        return m_log.size();
+    }
+
+    /** Write everything appended so far to the leader's stable storage. */
+    void Persist()
+    {
+        m_persisting = true;
+        Simulator::Schedule(m_persistDelay,
+                            &ReplicatedController::Persisted,
+                            this,
+                            (uint64_t)m_log.size());
+    }
+
+    void Persisted(uint64_t index)
+    {
+        m_persisting = false;
+        m_persistedIndex = index;
+        if (m_log.size() > index)
+        {
+            Persist();
+        }
+        AdvanceCommit();
+    }
+
+    void SyntheticChange()
+    {
+        if (m_alive)
+        {
+            Append({0, Mac48Address()});
+        }
+        m_loadEvent = Simulator::Schedule(Seconds(m_loadGap->GetValue()),
+                                          &ReplicatedController::SyntheticChange,
+                                          this);
+    }
+
+    /**
+     * Send the next batch to a follower, unless one is in flight.
+     * \param idx The follower.
+     * \param heartbeat Send even with no new entries.
+     */
+    void SendAppend(uint32_t idx, bool heartbeat)
+    {
+        Follower& f = m_followers[idx];
+        if (!m_socket || f.inflight)
+        {
+            return;
+        }
+        uint64_t last = m_log.size();
+        uint32_t count = (f.nextIndex <= last) ? std::min<uint64_t>(last - f.nextIndex + 1, m_maxBatch) : 0;
+        if (!count && !heartbeat)
+        {
+            return;
+        }
+        RaftHeader header;
+        header.type = RaftHeader::APPEND_ENTRIES;
+        header.term = m_term;
+        header.prevIndex = f.nextIndex - 1;
+        header.prevTerm = header.prevIndex ? m_log[header.prevIndex - 1].term : 0;
+        header.index = m_commitIndex;
+        header.entries = count;
+        Ptr<Packet> packet = Create<Packet>(count * m_entrySize);
+        packet->AddHeader(header);
+        m_appendBytes += packet->GetSize();
+        m_appendsSent++;
+        m_socket->SendTo(packet, 0, f.address);
+        f.inflight = count > 0;
+        f.sentAt = Simulator::Now();
+    }
+
+    void HandleReply(Ptr<Socket> socket)
+    {
+        Ptr<Packet> packet;
+        Address from;
+        while ((packet = socket->RecvFrom(from)))
+        {
+            RaftHeader reply;
+            packet->RemoveHeader(reply);
+            uint32_t idx = 0;
+            while (idx < m_followers.size() &&
+                   InetSocketAddress::ConvertFrom(m_followers[idx].address).GetIpv4() !=
+                       InetSocketAddress::ConvertFrom(from).GetIpv4())
+            {
+                idx++;
+            }
+            if (idx == m_followers.size() || reply.type != RaftHeader::APPEND_REPLY)
+            {
+                continue;
+            }
+            Follower& f = m_followers[idx];
+            f.inflight = false;
+            if (reply.success)
+            {
+                f.matchIndex = std::max(f.matchIndex, reply.index);
+                f.nextIndex = f.matchIndex + 1;
+                AdvanceCommit();
+            }
+            else
+            {
+                // Back up to the follower's log end and retry.
+                f.nextIndex = std::max<uint64_t>(1, std::min(f.nextIndex - 1, reply.index + 1));
+            }
+            SendAppend(idx, false);
+        }
+    }
+
+    /** Resend lost batches and keep idle followers up to date. */
+    void Heartbeat()
+    {
+        for (uint32_t i = 0; i < m_followers.size(); i++)
+        {
+            Follower& f = m_followers[i];
+            if (f.inflight && Simulator::Now() - f.sentAt >= 2 * m_heartbeatInterval)
+            {
+                f.inflight = false;
+                m_retransmissions++;
+            }
+            SendAppend(i, true);
+        }
+        m_heartbeatEvent =
+            Simulator::Schedule(m_heartbeatInterval, &ReplicatedController::Heartbeat, this);
+    }
+
+    /** Commit the highest index stored by a majority, then apply. */
+    void AdvanceCommit()
+    {
+        std::vector<uint64_t> stored(1, m_persistedIndex);
+        for (const auto& f : m_followers)
+        {
+            stored.push_back(f.matchIndex);
+        }
+        std::sort(stored.begin(), stored.end(), std::greater<uint64_t>());
+        uint64_t majority = stored[stored.size() / 2];
+        if (majority <= m_commitIndex || m_log[majority - 1].term != m_term)
+        {
+            return;
+        }
+        Time now = Simulator::Now();
+        while (m_commitIndex < majority)
+        {
+            LogEntry& entry = m_log[m_commitIndex++];
+            m_commitNs.push_back((now - entry.appended).GetNanoSeconds());
+            m_commitWindows[now.GetMilliSeconds() / 100]++;
+            m_pending.erase(entry.location);
+
+            // Now learn, install and forward for real.
+            std::vector<HeldPacketIn> held;
+            held.swap(entry.held);
+            for (const auto& h : held)
+            {
+                m_heldNs.push_back((now - h.arrival).GetNanoSeconds());
+                DomainController::HandlePacketIn(h.msg, h.swtch, h.xid);
+            }
+        }
+        m_lastCommit = now;
+    }
+
+    static double Mean(const std::vector<int64_t>& v)
+    {
+        double sum = 0;
+        for (int64_t x : v)
+        {
+            sum += x;
+        }
+        return v.empty() ? 0 : sum / v.size();
+    }
+
+    static double Percentile(std::vector<int64_t> v, double p)
+    {
+        if (v.empty())
+        {
+            return 0;
+        }
+        std::sort(v.begin(), v.end());
+        return v[std::min<size_t>(v.size() - 1, p * v.size())];
+    }
+
+    uint16_t m_port;
+    Time m_persistDelay;
+    Time m_heartbeatInterval;
+    uint32_t m_maxBatch;
+    uint32_t m_entrySize;
+    uint64_t m_term{1};
+    std::vector<LogEntry> m_log;
+    std::map<std::pair<uint64_t, Mac48Address>, uint64_t> m_pending; //!< Uncommitted hosts
+    std::vector<Follower> m_followers;
+    Ptr<Socket> m_socket;
+    EventId m_heartbeatEvent;
+    bool m_persisting{false};
+    uint64_t m_persistedIndex{0};
+    uint64_t m_commitIndex{0};
+    Ptr<ExponentialRandomVariable> m_loadGap;
+    EventId m_loadEvent;
+    std::vector<int64_t> m_commitNs;
+    std::vector<int64_t> m_heldNs;
+    std::map<int64_t, uint64_t> m_commitWindows; //!< Commits per 100 ms
+    Time m_firstAppend;
+    Time m_lastCommit;
+    uint64_t m_appendsSent{0};
+    uint64_t m_appendBytes{0};
+    uint32_t m_retransmissions{0};
+};
+
+NS_OBJECT_ENSURE_REGISTERED(ReplicatedController);
+
+} // namespace ns3
+
+#endif /* REPLICATED_CONTROLLER_H */
@@ -0,0 +1,387 @@
+/*
+ * Request/response workload over UDP.
+ *
+ * Each client sends fixed-size requests to one server at a fixed interval;
+ * the server answers every request with a response of configurable size
+ * that echoes the request's sequence number and send time (SeqTsHeader).
+ * Clients hand each round-trip time to a shared RttRecorder through a
+ * direct pointer, which keeps one compact sample per answered request and
+ * per-client counters in flat arrays: no log line and no trace path lookup
+ * per packet, so the cost per request does not grow with the client count.
+ */
+
+#ifndef REQUEST_RESPONSE_H
+#define REQUEST_RESPONSE_H
+
+#include <ns3/applications-module.h>
+#include <ns3/core-module.h>
+#include <ns3/internet-module.h>
+#include <ns3/network-module.h>
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Collects the round-trip times of all clients.
+ */
+class RttRecorder : public SimpleRefCount<RttRecorder>
+{
+  public:
+    /**
+     * \param clients Number of clients, indexed 0..clients-1.
+     */
+    explicit RttRecorder(uint32_t clients)
+        : m_sent(clients, 0),
+          m_answered(clients, 0)
+    {
+    }
+
+    /** A request left client idx. */
+    void Sent(uint32_t idx)
+    {
+        m_sent[idx]++;
+    }
+
+    /** A response reached client idx after rtt. */
+    void Answered(uint32_t idx, Time rtt)
+    {
+        m_answered[idx]++;
+        m_rttNs.push_back(rtt.GetNanoSeconds());
+    }
+
+    /**
+     * Print request counts and RTT statistics over all clients.
+     */
+    void Report()
+    {
+        uint64_t sent = 0;
+        uint64_t answered = 0;
+        uint32_t starved = 0;
+        for (uint32_t i = 0; i < m_sent.size(); i++)
+        {
+            sent += m_sent[i];
+            answered += m_answered[i];
+            starved += (m_sent[i] && !m_answered[i]) ? 1 : 0;
+        }
+        NS_LOG_UNCOND("--------Request/response----------" << std::endl);
+        NS_LOG_UNCOND("Requests sent =" << sent << " answered =" << answered
+                                        << " clients without answer =" << starved);
+        if (m_rttNs.empty())
+        {
+            return;
+        }
+        std::sort(m_rttNs.begin(), m_rttNs.end());
+        double sum = 0;
+        for (int64_t rtt : m_rttNs)
+        {
+            sum += rtt;
+        }
+        NS_LOG_UNCOND("RTT mean =" << sum / m_rttNs.size() / 1e6 << "ms"
+                                   << " p50 =" << Percentile(0.50) / 1e6 << "ms"
+                                   << " p99 =" << Percentile(0.99) / 1e6 << "ms"
+                                   << " max =" << m_rttNs.back() / 1e6 << "ms");
+    }
+
+    /**
+     * Write every recorded RTT, in milliseconds, one per line.
+     * \param filename The output file name.
+     */
+    void WriteSamples(std::string filename) const
+    {
+        std::ofstream out(filename);
+        for (int64_t rtt : m_rttNs)
+        {
+            out << rtt / 1e6 << "\n";
+        }
+    }
+
+  private:
+    /** \return the p-th percentile of the sorted samples, in ns. */
+    double Percentile(double p) const
+    {
+        return m_rttNs[std::min<size_t>(m_rttNs.size() - 1, p * m_rttNs.size())];
+    }
+
+    std::vector<uint64_t> m_sent;
+    std::vector<uint64_t> m_answered;
+    std::vector<int64_t> m_rttNs;
+};
+
+/**
+ * Answers every request with a response of fixed size.
+ */
+class RequestResponseServer : public Application
+{
+  public:
+    static TypeId GetTypeId()
+    {
+        static TypeId tid =
+            TypeId("ns3::RequestResponseServer")
+                .SetParent<Application>()
+                .AddConstructor<RequestResponseServer>()
+                .AddAttribute("Port",
+                              "Port on which requests are received",
+                              UintegerValue(9),
+                              MakeUintegerAccessor(&RequestResponseServer::m_port),
+                              MakeUintegerChecker<uint16_t>())
+                .AddAttribute("ResponseSize",
+                              "Response size in bytes, including the header",
+                              UintegerValue(1024),
+                              MakeUintegerAccessor(&RequestResponseServer::m_responseSize),
+                              MakeUintegerChecker<uint32_t>(12));
+        return tid;
+    }
+
+    /** \return the number of requests answered. */
+    uint64_t GetAnswered() const
+    {
+        return m_answered;
+    }
+
+  private:
+    void StartApplication() override
+    {
+        m_socket = Socket::CreateSocket(GetNode(), UdpSocketFactory::GetTypeId());
+        m_socket->Bind(InetSocketAddress(Ipv4Address::GetAny(), m_port));
+        m_socket->SetRecvCallback(MakeCallback(&RequestResponseServer::HandleRead, this));
+    }
+
+    void StopApplication() override
+    {
+        if (m_socket)
+        {
+            m_socket->Close();
+            m_socket->SetRecvCallback(MakeNullCallback<void, Ptr<Socket>>());
+            m_socket = nullptr;
+        }
+    }
+
+    void HandleRead(Ptr<Socket> socket)
+    {
+        Ptr<Packet> request;
+        Address from;
+        while ((request = socket->RecvFrom(from)))
+        {
+            SeqTsHeader header;
+            request->RemoveHeader(header);
+            Ptr<Packet> response = Create<Packet>(m_responseSize - header.GetSerializedSize());
+            response->AddHeader(header);
+            socket->SendTo(response, 0, from);
+            m_answered++;
+        }
+    }
+
+    uint16_t m_port;
+    uint32_t m_responseSize;
+    Ptr<Socket> m_socket;
+    uint64_t m_answered{0};
+};
+
+NS_OBJECT_ENSURE_REGISTERED(RequestResponseServer);
+
+/**
+ * Sends requests at a fixed interval and records their round-trip times.
+ */
+class RequestResponseClient : public Application
+{
+  public:
+    static TypeId GetTypeId()
+    {
+        static TypeId tid =
+            TypeId("ns3::RequestResponseClient")
+                .SetParent<Application>()
+                .AddConstructor<RequestResponseClient>()
+                .AddAttribute("Remote",
+                              "The server address and port",
+                              AddressValue(),
+                              MakeAddressAccessor(&RequestResponseClient::m_remote),
+                              MakeAddressChecker())
+                .AddAttribute("RequestSize",
+                              "Request size in bytes, including the header",
+                              UintegerValue(1024),
+                              MakeUintegerAccessor(&RequestResponseClient::m_requestSize),
+                              MakeUintegerChecker<uint32_t>(12))
+                .AddAttribute("Interval",
+                              "Time between requests",
+                              TimeValue(MilliSeconds(200)),
+                              MakeTimeAccessor(&RequestResponseClient::m_interval),
+                              MakeTimeChecker())
+                .AddAttribute("MaxRequests",
+                              "Requests to send (0 for no limit)",
+                              UintegerValue(100),
+                              MakeUintegerAccessor(&RequestResponseClient::m_maxRequests),
+                              MakeUintegerChecker<uint32_t>());
+        return tid;
+    }
+
+    /**
+     * \param recorder Where round-trip times are recorded.
+     * \param idx This client's index in the recorder.
+     */
+    void SetRecorder(Ptr<RttRecorder> recorder, uint32_t idx)
+    {
+        m_recorder = recorder;
+        m_idx = idx;
+    }
+
+  private:
+    void DoDispose() override
+    {
+        m_recorder = nullptr;
+        Application::DoDispose();
+    }
+
+    void StartApplication() override
+    {
+        m_socket = Socket::CreateSocket(GetNode(), UdpSocketFactory::GetTypeId());
+        m_socket->Bind();
+        m_socket->SetRecvCallback(MakeCallback(&RequestResponseClient::HandleRead, this));
+        Send();
+    }
+
+    void StopApplication() override
+    {
+        Simulator::Cancel(m_sendEvent);
+        if (m_socket)
+        {
+            m_socket->Close();
+            m_socket->SetRecvCallback(MakeNullCallback<void, Ptr<Socket>>());
+            m_socket = nullptr;
+        }
+    }
+
+    void Send()
+    {
+        SeqTsHeader header;
+        header.SetSeq(m_seq++);
+        Ptr<Packet> request = Create<Packet>(m_requestSize - header.GetSerializedSize());
+        request->AddHeader(header);
+        m_socket->SendTo(request, 0, m_remote);
+        if (m_recorder)
+        {
+            m_recorder->Sent(m_idx);
+        }
+        if (!m_maxRequests || m_seq < m_maxRequests)
+        {
+            m_sendEvent = Simulator::Schedule(m_interval, &RequestResponseClient::Send, this);
+        }
+    }
+
+    void HandleRead(Ptr<Socket> socket)
+    {
+        Ptr<Packet> response;
+        while ((response = socket->Recv()))
+        {
+            SeqTsHeader header;
+            response->RemoveHeader(header);
+            if (m_recorder)
+            {
+                m_recorder->Answered(m_idx, Simulator::Now() - header.GetTs());
+            }
+        }
+    }
+
+    Address m_remote;
+    uint32_t m_requestSize;
+    Time m_interval;
+    uint32_t m_maxRequests;
+    Ptr<Socket> m_socket;
+    EventId m_sendEvent;
+    uint32_t m_seq{0};
+    Ptr<RttRecorder> m_recorder;
+    uint32_t m_idx{0};
+};
+
+NS_OBJECT_ENSURE_REGISTERED(RequestResponseClient);
+
+/**
+ * Installs servers and clients, client i talking to server i mod servers.
+ */
+class RequestResponseHelper : public SimpleRefCount<RequestResponseHelper>
+{
+  public:
+    /**
+     * \param port The server port.
+     */
+    explicit RequestResponseHelper(uint16_t port = 9)
+        : m_port(port)
+    {
+        m_client.SetTypeId(RequestResponseClient::GetTypeId());
+        m_server.SetTypeId(RequestResponseServer::GetTypeId());
+    }
+
+    /** Set an attribute of the clients. */
+    void SetClientAttribute(std::string name, const AttributeValue& value)
+    {
+        m_client.Set(name, value);
+    }
+
+    /** Set an attribute of the servers. */
+    void SetServerAttribute(std::string name, const AttributeValue& value)
+    {
+        m_server.Set(name, value);
+    }
+
+    /**
+     * Install the applications. Client start times are spread uniformly
+     * over one request interval, so the clients do not fire in lockstep.
+     * \param clients The client hosts.
+     * \param servers The server hosts.
+     * \param serverAddresses The IPv4 address of each server.
+     * \param start Start time of the applications.
+     * \param stop Stop time of the applications.
+     */
+    void Install(NodeContainer clients,
+                 NodeContainer servers,
+                 Ipv4InterfaceContainer serverAddresses,
+                 Time start,
+                 Time stop)
+    {
+        m_server.Set("Port", UintegerValue(m_port));
+        for (uint32_t i = 0; i < servers.GetN(); i++)
+        {
+            Ptr<Application> app = m_server.Create<Application>();
+            servers.Get(i)->AddApplication(app);
+            app->SetStartTime(start);
+            app->SetStopTime(stop);
+        }
+
+        m_recorder = Create<RttRecorder>(clients.GetN());
+        TimeValue interval;
+        m_client.Create<RequestResponseClient>()->GetAttribute("Interval", interval);
+        Ptr<UniformRandomVariable> jitter = CreateObject<UniformRandomVariable>();
+        for (uint32_t i = 0; i < clients.GetN(); i++)
+        {
+            m_client.Set("Remote",
+                         AddressValue(InetSocketAddress(
+                             serverAddresses.GetAddress(i % serverAddresses.GetN()),
+                             m_port)));
+            Ptr<RequestResponseClient> app = m_client.Create<RequestResponseClient>();
+            app->SetRecorder(m_recorder, i);
+            clients.Get(i)->AddApplication(app);
+            app->SetStartTime(start + Seconds(jitter->GetValue(0, interval.Get().GetSeconds())));
+            app->SetStopTime(stop);
+        }
+    }
+
+    /** \return the recorder shared by the installed clients. */
+    Ptr<RttRecorder> GetRecorder() const
+    {
+        return m_recorder;
+    }
+
+  private:
+    uint16_t m_port;
+    ObjectFactory m_client;
+    ObjectFactory m_server;
+    Ptr<RttRecorder> m_recorder;
+};
+
+} // namespace ns3
+
+#endif /* REQUEST_RESPONSE_H */
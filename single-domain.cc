@@ -29,6 +29,10 @@
  *                  +----------+     +----------+
  *       Host 0 === | Switch 0 | === | Switch 1 | === Host 1
  *                  +----------+     +----------+
+ *
+ * With --cluster=N the controller is the leader of an N-node controller
+ * cluster that replicates learned host state through a Raft-style log
+ * over a management LAN (see replicated-controller.h).
  */
 
 #include <ns3/core-module.h>
@@ -40,6 +44,9 @@
 #include <ns3/applications-module.h>
 #include <ns3/flow-monitor-module.h>
 
+#include "pcapng-capture.h"
+#include "replicated-controller.h"
+
 using namespace ns3;
 
 int
@@ -48,6 +55,14 @@ main(int argc, char* argv[])
     uint16_t simTime = 10;
     bool verbose = false;
     bool trace = false;
+    uint32_t snapLen = 0;
+    uint32_t sampleRate = 1;
+    bool sampleFlows = false;
+    uint32_t cluster = 0;
+    double clusterDelay = 0.5;
+    double persistDelay = 1;
+    uint32_t maxBatch = 256;
+    double stateLoad = 0;
     uint32_t SentPackets = 0;
     uint32_t ReceivedPackets = 0;
     uint32_t LostPackets = 0;
@@ -57,8 +72,23 @@ main(int argc, char* argv[])
     cmd.AddValue("simTime", "Simulation time (seconds)", simTime);
     cmd.AddValue("verbose", "Enable verbose output", verbose);
     cmd.AddValue("trace", "Enable datapath stats and pcap traces", trace);
+    cmd.AddValue("snapLen", "Captured bytes per frame (0 for full frames)", snapLen);
+    cmd.AddValue("sampleRate", "Capture one in N packets (or flows)", sampleRate);
+    cmd.AddValue("sampleFlows", "Sample whole flows instead of packets", sampleFlows);
+    cmd.AddValue("cluster",
+                 "Controller cluster size, replicating state through a Raft-style log "
+                 "(0 for the default learning controller)",
+                 cluster);
+    cmd.AddValue("clusterDelay", "One-way delay of the cluster management LAN (ms)", clusterDelay);
+    cmd.AddValue("persistDelay", "Time to persist a batch of log entries (ms)", persistDelay);
+    cmd.AddValue("maxBatch", "Most log entries per AppendEntries message", maxBatch);
+    cmd.AddValue("stateLoad",
+                 "Extra controller state changes per second, to find the commit ceiling",
+                 stateLoad);
     cmd.Parse(argc, argv);
 
+    NS_ABORT_MSG_IF(cluster > 7, "Cluster of at most 7 controllers");
+
     if (verbose)
     {
         OFSwitch13Helper::EnableDatapathLogs();
@@ -131,7 +161,17 @@ main(int argc, char* argv[])
 
     // Configure the OpenFlow network domain
     Ptr<OFSwitch13InternalHelper> of13Helper = CreateObject<OFSwitch13InternalHelper>();
-    of13Helper->InstallController(controllerNode);
+    Ptr<ReplicatedController> leader;
+    if (cluster)
+    {
+        leader = CreateObject<ReplicatedController>();
+        leader->SetReplication(MicroSeconds(persistDelay * 1000), MilliSeconds(50), maxBatch, 64);
+        of13Helper->InstallController(controllerNode, leader);
+    }
+    else
+    {
+        of13Helper->InstallController(controllerNode);
+    }
     of13Helper->InstallSwitch(switches.Get(0), switchPorts[0]);
     of13Helper->InstallSwitch(switches.Get(1), switchPorts[1]);
     of13Helper->CreateOpenFlowChannels();
@@ -140,6 +180,39 @@ main(int argc, char* argv[])
     InternetStackHelper internet;
     internet.Install(hosts);
 
+    // Connect the cluster members to the leader over a management LAN
+    if (cluster)
+    {
+        NodeContainer members(controllerNode);
+        NodeContainer followers;
+        followers.Create(cluster - 1);
+        members.Add(followers);
+        internet.Install(followers);
+        if (!controllerNode->GetObject<Ipv4>())
+        {
+            internet.Install(controllerNode);
+        }
+        CsmaHelper mgmtHelper;
+        mgmtHelper.SetChannelAttribute("DataRate", DataRateValue(DataRate("1Gbps")));
+        mgmtHelper.SetChannelAttribute("Delay", TimeValue(MicroSeconds(clusterDelay * 1000)));
+        Ipv4AddressHelper mgmtIpv4;
+        mgmtIpv4.SetBase("10.200.0.0", "255.255.255.0");
+        Ipv4InterfaceContainer mgmtIfaces = mgmtIpv4.Assign(mgmtHelper.Install(members));
+        for (uint32_t i = 0; i < followers.GetN(); i++)
+        {
+            Ptr<RaftFollower> follower = CreateObject<RaftFollower>();
+            follower->SetAttribute("PersistDelay", TimeValue(MicroSeconds(persistDelay * 1000)));
+            followers.Get(i)->AddApplication(follower);
+            follower->SetStartTime(Seconds(0));
+            leader->AddFollower(mgmtIfaces.GetAddress(i + 1));
+        }
+        leader->StartReplication();
+        if (stateLoad > 0)
+        {
+            Simulator::Schedule(Seconds(1), &ReplicatedController::StartStateLoad, leader, stateLoad);
+        }
+    }
+
     // Set IPv4 host addresses
     Ipv4AddressHelper ipv4;
     ipv4.SetBase ("10.1.1.0", "255.255.255.0");
@@ -160,13 +233,18 @@ main(int argc, char* argv[])
     
 
     // Enable datapath stats and pcap traces at hosts, switch(es), and controller(s)
+    Ptr<PcapngCaptureSink> capture;
     if (trace)
     {
-        of13Helper->EnableOpenFlowPcap("openflow");
+        capture = Create<PcapngCaptureSink>("single-domain.pcapng");
+        capture->SetSnapLen(snapLen);
+        capture->SetSampling(sampleFlows ? PcapngCaptureSink::SAMPLE_FLOWS : PcapngCaptureSink::SAMPLE_PACKETS,
+                             sampleRate);
+        capture->AddNodeDevices(controllerNode, "openflow", true);
         of13Helper->EnableDatapathStats("switch-stats");
-        csmaHelper.EnablePcap("switch", switchPorts[0], true);
-        csmaHelper.EnablePcap("switch", switchPorts[1], true);
-        csmaHelper.EnablePcap("host", hostDevices);
+        capture->AddDevices(switchPorts[0], "switch", true);
+        capture->AddDevices(switchPorts[1], "switch", true);
+        capture->AddDevices(hostDevices, "host", false);
     }
 
     // Run the simulation
@@ -174,6 +252,14 @@ main(int argc, char* argv[])
     FlowMonitorHelper flowmon;
     Ptr<FlowMonitor> monitor = flowmon.InstallAll();
     Simulator::Run();
+    if (capture)
+    {
+        capture->Close();
+        NS_LOG_UNCOND("Captured frames =" << capture->GetCapturedFrames()
+                      << " dropped =" << capture->GetDroppedFrames()
+                      << " sampled out =" << capture->GetSampledOutFrames()
+                      << " bytes =" << capture->GetCapturedBytes());
+    }
     int j=0;
     float AvgThroughput = 0;
     Time Jitter;
@@ -219,6 +305,10 @@ main(int argc, char* argv[])
     NS_LOG_UNCOND("End to End Delay =" << Delay);
     NS_LOG_UNCOND("End to End Jitter delay =" << Jitter);
     NS_LOG_UNCOND("Total Flod id " << j);
+    if (leader)
+    {
+        leader->ReportReplication();
+    }
     monitor->SerializeToXmlFile("manet-routing.xml", true, true);
     Simulator::Destroy();
 }
@@ -0,0 +1,49 @@
+/*
+ * Static ARP entries between hosts.
+ *
+ * NeighborCacheHelper only fills entries for neighbors on the same channel,
+ * and in the OpenFlow scenarios every host sits on its own link to a switch
+ * port without IPv4, so it finds none. This fills each host interface's ARP
+ * cache with permanent entries for all the other hosts instead.
+ */
+
+#ifndef STATIC_ARP_H
+#define STATIC_ARP_H
+
+#include <ns3/internet-module.h>
+#include <ns3/network-module.h>
+
+namespace ns3
+{
+
+/**
+ * Add a permanent ARP entry for every other host to each host's cache.
+ * \param addresses The host interfaces.
+ * \param devices The host devices, in the same order.
+ * \return the number of entries added.
+ */
+inline uint32_t
+PopulateArp(Ipv4InterfaceContainer addresses, NetDeviceContainer devices)
+{
+    uint32_t added = 0;
+    for (uint32_t i = 0; i < addresses.GetN(); i++)
+    {
+        Ptr<Ipv4L3Protocol> ipv4 = DynamicCast<Ipv4L3Protocol>(addresses.Get(i).first);
+        Ptr<ArpCache> cache = ipv4->GetInterface(addresses.Get(i).second)->GetArpCache();
+        for (uint32_t j = 0; j < addresses.GetN(); j++)
+        {
+            if (j != i)
+            {
+                ArpCache::Entry* entry = cache->Add(addresses.GetAddress(j));
+                entry->SetMacAddress(devices.Get(j)->GetAddress());
+                entry->MarkPermanent();
+                added++;
+            }
+        }
+    }
+    return added;
+}
+
+} // namespace ns3
+
+#endif /* STATIC_ARP_H */
@@ -0,0 +1,359 @@
+/*
+ * Traffic-matrix workload generator.
+ *
+ * Installs many finite TCP flows between the hosts of a scenario. Source and
+ * destination of each flow are drawn from a traffic matrix (uniform
+ * all-to-all, a random permutation, hotspot/incast, or weights read from a
+ * file), flows arrive as a Poisson process and their sizes follow a bounded
+ * Pareto distribution. Every flow gets its own destination port, so
+ * FlowMonitor and the sinks can tell flows apart.
+ *
+ * Matrix files hold one "src dst weight" triple per line, with host indexes
+ * into the NodeContainer given to Install (). Lines starting with '#' are
+ * ignored.
+ */
+
+#ifndef TRAFFIC_MATRIX_H
+#define TRAFFIC_MATRIX_H
+
+#include <ns3/applications-module.h>
+#include <ns3/core-module.h>
+#include <ns3/internet-module.h>
+#include <ns3/network-module.h>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * One flow installed by the workload generator.
+ */
+struct WorkloadFlow
+{
+    uint32_t id;                 //!< Flow index
+    uint32_t src;                //!< Source host index
+    uint32_t dst;                //!< Destination host index
+    uint16_t port;               //!< Destination port, unique per flow
+    uint64_t bytes;              //!< Flow size
+    Time start;                  //!< Arrival time
+    Ptr<BulkSendApplication> sender;
+    Ptr<PacketSink> sink;
+};
+
+/**
+ * Traffic-matrix workload generator.
+ */
+class TrafficMatrixWorkload : public SimpleRefCount<TrafficMatrixWorkload>
+{
+  public:
+    /** Supported traffic matrices. */
+    enum Pattern
+    {
+        UNIFORM,     //!< Every host sends to every other host
+        PERMUTATION, //!< Every host sends to exactly one other host
+        HOTSPOT,     //!< A share of the traffic goes to a few hot hosts
+        MATRIX_FILE  //!< Weights read from a file
+    };
+
+    TrafficMatrixWorkload()
+    {
+        m_arrival = CreateObject<ExponentialRandomVariable>();
+        m_size = CreateObject<ParetoRandomVariable>();
+        m_pick = CreateObject<UniformRandomVariable>();
+        SetFlowSize(100000, 1.2, 100000000);
+    }
+
+    /**
+     * Select the traffic matrix by name: "uniform", "permutation",
+     * "hotspot" (half of the traffic to 10% of the hosts), "incast" (all
+     * traffic to host 0) or the name of a matrix file.
+     * \param name The pattern name.
+     */
+    void SetPattern(std::string name)
+    {
+        if (name == "uniform")
+        {
+            m_pattern = UNIFORM;
+        }
+        else if (name == "permutation")
+        {
+            m_pattern = PERMUTATION;
+        }
+        else if (name == "hotspot")
+        {
+            SetHotspots(0, 0.5);
+        }
+        else if (name == "incast")
+        {
+            SetHotspots(1, 1.0);
+        }
+        else
+        {
+            m_pattern = MATRIX_FILE;
+            m_matrixFile = name;
+        }
+    }
+
+    /**
+     * Use a hotspot matrix.
+     * \param hotspots Number of hot destinations (0 for 10% of the hosts).
+     * \param share Fraction of the flows sent to the hot destinations.
+     */
+    void SetHotspots(uint32_t hotspots, double share)
+    {
+        m_pattern = HOTSPOT;
+        m_hotspots = hotspots;
+        m_hotShare = share;
+    }
+
+    /**
+     * \param flowsPerSecond Aggregate Poisson arrival rate over all pairs.
+     */
+    void SetArrivalRate(double flowsPerSecond)
+    {
+        NS_ABORT_MSG_IF(flowsPerSecond <= 0, "Flow arrival rate must be positive");
+        m_arrival->SetAttribute("Mean", DoubleValue(1.0 / flowsPerSecond));
+    }
+
+    /**
+     * Flow sizes follow a bounded Pareto distribution.
+     * \param meanBytes Mean of the unbounded distribution.
+     * \param shape Pareto shape; values close to 1 give heavier tails.
+     * \param maxBytes Upper bound of a single flow.
+     */
+    void SetFlowSize(uint64_t meanBytes, double shape, uint64_t maxBytes)
+    {
+        NS_ABORT_MSG_IF(shape <= 1, "Pareto shape must be larger than 1");
+        m_size->SetAttribute("Scale", DoubleValue(meanBytes * (shape - 1) / shape));
+        m_size->SetAttribute("Shape", DoubleValue(shape));
+        m_size->SetAttribute("Bound", DoubleValue(maxBytes));
+    }
+
+    /**
+     * \param port The destination port of the first flow; flow i uses port + i.
+     */
+    void SetBasePort(uint16_t port)
+    {
+        m_basePort = port;
+    }
+
+    /**
+     * Assign fixed random variable streams.
+     * \param stream First stream index.
+     * \return the number of streams used.
+     */
+    int64_t AssignStreams(int64_t stream)
+    {
+        m_arrival->SetStream(stream);
+        m_size->SetStream(stream + 1);
+        m_pick->SetStream(stream + 2);
+        return 3;
+    }
+
+    /**
+     * Draw the flows and install a BulkSend application and a PacketSink
+     * for each of them.
+     * \param hosts The hosts, indexed as in the traffic matrix.
+     * \param addresses The IPv4 address of each host.
+     * \param start The earliest flow arrival.
+     * \param stop No flow arrives after this time.
+     */
+    void Install(NodeContainer hosts, Ipv4InterfaceContainer addresses, Time start, Time stop)
+    {
+        uint32_t nHosts = hosts.GetN();
+        NS_ABORT_MSG_IF(nHosts < 2, "Workload needs at least two hosts");
+        BuildMatrix(nHosts);
+
+        BulkSendHelper sender("ns3::TcpSocketFactory", Address());
+        PacketSinkHelper sink("ns3::TcpSocketFactory", Address());
+        Time now = start;
+        while (true)
+        {
+            now += Seconds(m_arrival->GetValue());
+            if (now >= stop)
+            {
+                break;
+            }
+            NS_ABORT_MSG_IF(m_basePort + m_flows.size() > 65535,
+                            "Out of ports: lower the flow rate or the duration");
+
+            WorkloadFlow flow;
+            flow.id = m_flows.size();
+            PickPair(flow.src, flow.dst);
+            flow.port = m_basePort + flow.id;
+            flow.bytes = std::max<uint64_t>(1, m_size->GetInteger());
+            flow.start = now;
+
+            sink.SetAttribute("Local",
+                              AddressValue(InetSocketAddress(Ipv4Address::GetAny(), flow.port)));
+            ApplicationContainer sinkApp = sink.Install(hosts.Get(flow.dst));
+            sinkApp.Start(now);
+            flow.sink = DynamicCast<PacketSink>(sinkApp.Get(0));
+
+            sender.SetAttribute(
+                "Remote",
+                AddressValue(InetSocketAddress(addresses.GetAddress(flow.dst), flow.port)));
+            sender.SetAttribute("MaxBytes", UintegerValue(flow.bytes));
+            ApplicationContainer sendApp = sender.Install(hosts.Get(flow.src));
+            sendApp.Start(now);
+            flow.sender = DynamicCast<BulkSendApplication>(sendApp.Get(0));
+
+            m_totalBytes += flow.bytes;
+            m_flows.push_back(flow);
+        }
+    }
+
+    /** \return the installed flows, in arrival order. */
+    const std::vector<WorkloadFlow>& GetFlows() const
+    {
+        return m_flows;
+    }
+
+    /** \return the sum of all flow sizes. */
+    uint64_t GetTotalBytes() const
+    {
+        return m_totalBytes;
+    }
+
+  private:
+    /** A non-zero matrix entry. */
+    struct Entry
+    {
+        uint32_t src;
+        uint32_t dst;
+        double cumWeight; //!< Running sum of weights up to this entry
+    };
+
+    /**
+     * Build the sparse matrix as a cumulative weight list, so drawing a pair
+     * is a binary search.
+     * \param nHosts Number of hosts.
+     */
+    void BuildMatrix(uint32_t nHosts)
+    {
+        std::vector<std::vector<double>> weight(nHosts, std::vector<double>(nHosts, 0));
+        switch (m_pattern)
+        {
+        case UNIFORM:
+            for (uint32_t s = 0; s < nHosts; s++)
+            {
+                for (uint32_t d = 0; d < nHosts; d++)
+                {
+                    weight[s][d] = (s != d) ? 1 : 0;
+                }
+            }
+            break;
+        case PERMUTATION: {
+            // Random derangement: shuffle, then rotate any fixed point away.
+            std::vector<uint32_t> perm(nHosts);
+            for (uint32_t i = 0; i < nHosts; i++)
+            {
+                perm[i] = i;
+            }
+            for (uint32_t i = nHosts - 1; i > 0; i--)
+            {
+                std::swap(perm[i], perm[m_pick->GetInteger(0, i)]);
+            }
+            for (uint32_t i = 0; i < nHosts; i++)
+            {
+                if (perm[i] == i)
+                {
+                    std::swap(perm[i], perm[(i + 1) % nHosts]);
+                }
+            }
+            for (uint32_t s = 0; s < nHosts; s++)
+            {
+                weight[s][perm[s]] = 1;
+            }
+            break;
+        }
+        case HOTSPOT: {
+            uint32_t hot = m_hotspots ? m_hotspots : std::max<uint32_t>(1, nHosts / 10);
+            NS_ABORT_MSG_IF(hot >= nHosts, "Too many hotspots for " << nHosts << " hosts");
+            double hotWeight = m_hotShare / hot;
+            double coldWeight = (1 - m_hotShare) / (nHosts - hot);
+            for (uint32_t s = 0; s < nHosts; s++)
+            {
+                for (uint32_t d = 0; d < nHosts; d++)
+                {
+                    weight[s][d] = (s == d) ? 0 : (d < hot ? hotWeight : coldWeight);
+                }
+            }
+            break;
+        }
+        case MATRIX_FILE: {
+            std::ifstream file(m_matrixFile);
+            NS_ABORT_MSG_IF(!file, "Can't open traffic matrix " << m_matrixFile);
+            std::string line;
+            while (std::getline(file, line))
+            {
+                if (line.empty() || line[0] == '#')
+                {
+                    continue;
+                }
+                std::istringstream row(line);
+                uint32_t s;
+                uint32_t d;
+                double w;
+                NS_ABORT_MSG_IF(!(row >> s >> d >> w), "Bad traffic matrix line: " << line);
+                NS_ABORT_MSG_IF(s >= nHosts || d >= nHosts,
+                                "Traffic matrix refers to host beyond " << nHosts - 1);
+                weight[s][d] += w;
+            }
+            break;
+        }
+        }
+
+        double cum = 0;
+        m_entries.clear();
+        for (uint32_t s = 0; s < nHosts; s++)
+        {
+            for (uint32_t d = 0; d < nHosts; d++)
+            {
+                if (weight[s][d] > 0 && s != d)
+                {
+                    cum += weight[s][d];
+                    m_entries.push_back({s, d, cum});
+                }
+            }
+        }
+        NS_ABORT_MSG_IF(m_entries.empty(), "Traffic matrix has no flows");
+    }
+
+    /** Draw a (src, dst) pair proportionally to its matrix weight. */
+    void PickPair(uint32_t& src, uint32_t& dst)
+    {
+        double x = m_pick->GetValue(0, m_entries.back().cumWeight);
+        auto it = std::upper_bound(m_entries.begin(),
+                                   m_entries.end(),
+                                   x,
+                                   [](double v, const Entry& e) { return v < e.cumWeight; });
+        if (it == m_entries.end())
+        {
+            --it;
+        }
+        src = it->src;
+        dst = it->dst;
+    }
+
+    Pattern m_pattern{UNIFORM};
+    std::string m_matrixFile;
+    uint32_t m_hotspots{0};
+    double m_hotShare{0.5};
+    uint16_t m_basePort{10000};
+    Ptr<ExponentialRandomVariable> m_arrival;
+    Ptr<ParetoRandomVariable> m_size;
+    Ptr<UniformRandomVariable> m_pick;
+    std::vector<Entry> m_entries;
+    std::vector<WorkloadFlow> m_flows;
+    uint64_t m_totalBytes{0};
+};
+
+} // namespace ns3
+
+#endif /* TRAFFIC_MATRIX_H */